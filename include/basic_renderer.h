@@ -1,41 +1,70 @@
 #pragma once
 
+#include "bindless_table.h"
 #include "buffer.h"
 #include "commandbuffer.h"
 #include "commandpool.h"
-#include "descriptorpool.h"
+#include "descriptor_cache.h"
 #include "device.h"
 #include "framebuffer.h"
+#include "global_config.h"
+#include "gpu_timer.h"
 #include "pipeline.h"
+#include "pipeline_compiler.h"
+#include "pipeline_key.h"
+#include "pipeline_layout.h"
 #include "sampler.h"
-#include "swapchain.h"
+#include "render_target.h"
 #include "texture.h"
+#include "timeline_semaphore.h"
+#include "uniform_allocator.h"
+#include "upload_batch.h"
+#include <memory>
+#include <string>
 #include <vector>
 #include <vulkan/vulkan_core.h>
 class BasicRenderer {
 private:
     Device* device;
-    SwapChain* swapchain;
+    RenderTarget* target;
+    uint32_t framesInFlight;
+    bool dynamicRendering; // no render pass or framebuffers, passes are begun with vkCmdBeginRenderingKHR
     VkRenderPass renderPass;
-    Pipeline pipeline;
-    std::vector<Framebuffer> framebuffers;
+    PipelineLayout pipelineLayout;
+    PipelineKey pipelineKey;
+    std::shared_ptr<PipelineHandle> pipeline;
+    std::shared_ptr<PipelineHandle> pendingPipeline; // rebuilt after a shader change, swapped in at the start of a frame
+    uint32_t skippedDraws = 0;
+    std::vector<std::unique_ptr<Framebuffer>> framebuffers;
     CommandPool pool;
     std::vector<CommandBuffer> buffers;
     Buffer vertexBuffer;
     Buffer indexBuffer;
-    std::vector<Buffer> uniformBuffers;
-    std::vector<void*> uniformBuffersMapped;
-    DescriptorPool descriptorPool;
-    std::vector<VkDescriptorSet> descriptorSets;
+    UniformAllocator uniforms;
+    UploadBatch uploads;
     Texture texture;
     Sampler sampler;
+    DrawConstants drawConstants;
+    std::vector<InstanceData> instances;
+    std::vector<std::unique_ptr<Buffer>> instanceBuffers; // one per frame in flight, grown to fit the instance list
+    GpuTimer gpuTimer;
 public:
-    BasicRenderer(Device* device, SwapChain* swapchain);
+    BasicRenderer(Device* device, RenderTarget* target, const RenderConfig& config);
     ~BasicRenderer();
-    void render(size_t frame, Fence* fence, std::vector<Semaphore*> signalSemaphores = {}, std::vector<Semaphore*> waitSemaphores = {}, std::vector<VkPipelineStageFlags> waitStages = {});
+    void render(size_t frame, TimelinePoint signal, std::vector<Semaphore*> signalSemaphores = {}, std::vector<Semaphore*> waitSemaphores = {}, std::vector<VkPipelineStageFlags> waitStages = {});
     void destroyFramebuffers();
     void createFramebuffers();
+    void reloadShaders(const std::vector<std::string>& changed);
+    //every instance is drawn with the one quad in a single instanced draw, starting next frame
+    void setInstances(const std::vector<InstanceData>& instances);
+    //gpu time of each frame's command buffer, results come back frames in flight later
+    GpuTimer* getGpuTimer() { return &gpuTimer; }
+    //blocks until the pipeline compiled in the background is there, frames before that skip the draw
+    void waitForPipeline();
 private:
     void beginRenderPass(size_t frame);
-    void updateUniformBuffer(uint32_t currentImage);
+    void endRenderPass(size_t frame);
+    uint32_t updateUniformBuffer();
+    void updateInstanceBuffer(size_t frame);
+    VkDescriptorSet getDescriptorSet(size_t frame);
 };
\ No newline at end of file
@@ -0,0 +1,11 @@
+#pragma once
+
+#include "device.h"
+#include "global_config.h"
+#include <cstdint>
+
+// rewrites setCount descriptor sets per frame with vkUpdateDescriptorSets and then with an update template, and compares the two
+void runDescriptorUpdateBenchmark(Device* device, uint32_t setCount = 10000, uint32_t frameCount = 100);
+
+// draws instanceCount quads with one instanced draw per frame into an offscreen target, reports cpu and gpu time per frame
+void runInstancingBenchmark(Device* device, const RenderConfig& config, uint32_t instanceCount = 100000, uint32_t frameCount = 300);
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "descriptorpool.h"
+#include "device.h"
+#include "sampler.h"
+#include "texture.h"
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <vulkan/vulkan_core.h>
+
+//shaders declare the table as this set, see basic.frag
+const uint32_t BINDLESS_SET = 1;
+const uint32_t BINDLESS_TEXTURE_BINDING = 0;
+const uint32_t BINDLESS_SAMPLER_BINDING = 1;
+const uint32_t MAX_BINDLESS_TEXTURES = 4096;
+const uint32_t MAX_BINDLESS_SAMPLERS = 32;
+
+// one global descriptor set with every registered texture and sampler, shaders pick them by index.
+// slots are partially bound and update after bind, so registering never touches sets that are already recorded.
+// an index stays valid until it is released, and is only handed out again once the gpu can't be using it
+class BindlessTable {
+private:
+    Device* device;
+    VkDescriptorSetLayout setLayout;
+    std::unique_ptr<DescriptorPool> pool;
+    VkDescriptorSet set;
+    std::mutex mutex;
+    uint32_t textureCount = 0;
+    uint32_t samplerCount = 0;
+    std::vector<uint32_t> freeTextures;
+    std::vector<uint32_t> freeSamplers;
+    uint32_t liveTextures = 0;
+    uint32_t liveSamplers = 0;
+    void write(uint32_t binding, uint32_t index, VkDescriptorType type, const VkDescriptorImageInfo& imageInfo);
+public:
+    BindlessTable(Device* device);
+    ~BindlessTable();
+    uint32_t registerTexture(Texture* texture);
+    uint32_t registerImage(VkImageView view);
+    uint32_t registerSampler(Sampler* sampler);
+    void releaseTexture(uint32_t index);
+    void releaseSampler(uint32_t index);
+    VkDescriptorSetLayout getSetLayout() { return setLayout; }
+    VkDescriptorSet getSet() { return set; }
+    std::vector<VkDescriptorSetLayoutBinding> getBindings();
+    void bind(VkCommandBuffer buffer, VkPipelineLayout layout, VkPipelineBindPoint bindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS);
+};
@@ -2,23 +2,26 @@
 
 #include "commandbuffer.h"
 #include "device.h"
+#include "memory_allocator.h"
 #include <cstdint>
 #include <vulkan/vulkan_core.h>
 class Buffer {
 private:
     VkBuffer buffer;
-    VkDeviceMemory bufferMemory;
+    Allocation allocation;
     Device* device;
     uint64_t size;
 public:
-    Buffer(Device* device, uint64_t size, VkBufferUsageFlags usage, VkSharingMode sharingMode, VkMemoryPropertyFlags memoryProperties);
+    Buffer(Device* device, uint64_t size, VkBufferUsageFlags usage, VkSharingMode sharingMode, VkMemoryPropertyFlags memoryProperties, MemoryUsage memoryUsage = MEMORY_USAGE_UNKNOWN);
     ~Buffer();
     void* mapBuffer();
     void unmapBuffer();
-    void bindVertex(CommandBuffer* cmdBuffer);
+    void flush();
+    void invalidate();
+    void bindVertex(CommandBuffer* cmdBuffer, uint32_t binding = 0);
     void bindIndex(CommandBuffer* cmdBuffer);
     VkBuffer getHandle() { return buffer; }
     uint64_t getSize() { return size; }
 
-    static void copyBuffer(Device* device, Buffer* src, Buffer* dst, VkDeviceSize size);
+    static void copyBuffer(Device* device, Buffer* src, Buffer* dst, VkDeviceSize size, VkDeviceSize srcOffset = 0, VkDeviceSize dstOffset = 0);
 };
\ No newline at end of file
@@ -3,6 +3,9 @@
 #include "commandpool.h"
 #include "device.h"
 #include "fence.h"
+#include "pipeline_key.h"
+#include "timeline_semaphore.h"
+#include <cstdint>
 #include <semaphore.h>
 #include <vector>
 #include <vulkan/vulkan_core.h>
@@ -11,6 +14,29 @@ private:
     VkCommandBuffer buffer;
     CommandPool* pool;
     Device* device;
+
+    //last state recorded since startRecording, so repeated binds and sets can be dropped.
+    //tracked is the PipelineDynamicState bits whose value below is what the gpu will use
+    VkPipeline boundPipeline = VK_NULL_HANDLE;
+    uint32_t boundDynamicState = 0;
+    uint32_t tracked = 0;
+    bool viewportTracked = false;
+    bool scissorTracked = false;
+    VkViewport viewport{};
+    VkRect2D scissor{};
+    VkCullModeFlags cullMode = VK_CULL_MODE_NONE;
+    VkFrontFace frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+    VkPrimitiveTopology topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    bool depthTest = false;
+    bool depthWrite = false;
+    VkCompareOp depthCompareOp = VK_COMPARE_OP_LESS;
+    bool primitiveRestart = false;
+    VkPolygonMode polygonMode = VK_POLYGON_MODE_FILL;
+    bool blendEnable = false;
+    VkColorComponentFlags colorWriteMask = 0;
+    uint64_t issuedStateCount = 0;
+    uint64_t skippedStateCount = 0;
+    bool track(uint32_t bit, bool unchanged);
 public:
     CommandBuffer(Device* device, CommandPool* pool);
     ~CommandBuffer();
@@ -18,5 +44,26 @@ public:
     void stopRecording();
     void reset();
     void submit(VkQueue queue, Fence* fence = nullptr, std::vector<Semaphore*> signalSemaphores = {}, std::vector<Semaphore*> waitSemaphores = {}, std::vector<VkPipelineStageFlags> waitStages = {});
+    void submit(VkQueue queue, TimelinePoint signal, std::vector<TimelinePoint> waitPoints = {}, std::vector<VkPipelineStageFlags> waitPointStages = {},
+        std::vector<Semaphore*> signalSemaphores = {}, std::vector<Semaphore*> waitSemaphores = {}, std::vector<VkPipelineStageFlags> waitStages = {});
     VkCommandBuffer getHandle() { return buffer; }
+
+    //a pipeline resets every state it doesn't list as dynamic, dynamicState is its PipelineDynamicState bits
+    void bindPipeline(VkPipelineBindPoint bindPoint, VkPipeline pipeline, uint32_t dynamicState = 0);
+    void setViewport(const VkViewport& viewport);
+    void setScissor(const VkRect2D& scissor);
+    void setCullMode(VkCullModeFlags cullMode);
+    void setFrontFace(VkFrontFace frontFace);
+    void setPrimitiveTopology(VkPrimitiveTopology topology);
+    void setDepthTestEnable(bool depthTest);
+    void setDepthWriteEnable(bool depthWrite);
+    void setDepthCompareOp(VkCompareOp depthCompareOp);
+    void setPrimitiveRestartEnable(bool primitiveRestart);
+    void setPolygonMode(VkPolygonMode polygonMode);
+    void setColorBlendEnable(bool blendEnable);
+    void setColorWriteMask(VkColorComponentFlags colorWriteMask);
+    //sets everything the bound pipeline left dynamic to the values in key
+    void applyDynamicState(const PipelineKey& key);
+    uint64_t getIssuedStateCount() { return issuedStateCount; }
+    uint64_t getSkippedStateCount() { return skippedStateCount; }
 };
\ No newline at end of file
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "descriptorpool.h"
+#include "device.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include <vulkan/vulkan_core.h>
+
+const uint32_t DEFAULT_SETS_PER_POOL = 64;
+const uint32_t MAX_SETS_PER_POOL = 4096;
+
+// descriptors of one type to reserve per set, a pool for n sets gets n * ratio of each
+struct DescriptorPoolRatio {
+    VkDescriptorType type;
+    float ratio;
+};
+
+struct DescriptorAllocatorStats {
+    uint64_t setsAllocated = 0; // since the last reset
+    uint64_t peakSetsAllocated = 0; // most sets handed out between two resets
+    uint64_t totalSetsAllocated = 0;
+    uint64_t resetCount = 0;
+    uint32_t poolsInUse = 0;
+    uint32_t poolCount = 0; // in use plus reset pools waiting to be reused
+};
+
+// hands out descriptor sets from a chain of pools, a new bigger pool is added whenever the current one runs out.
+// reset() recycles every pool at once, so a per-frame allocator is reset when its frame slot comes around again.
+// one that is never reset holds static sets
+class DescriptorAllocator {
+private:
+    Device* device;
+    std::vector<DescriptorPoolRatio> ratios;
+    uint32_t setsPerPool;
+    std::vector<std::unique_ptr<DescriptorPool>> usedPools;
+    std::vector<std::unique_ptr<DescriptorPool>> freePools;
+    DescriptorAllocatorStats stats;
+    std::unique_ptr<DescriptorPool> takePool();
+public:
+    DescriptorAllocator(Device* device, std::vector<DescriptorPoolRatio> ratios, uint32_t setsPerPool = DEFAULT_SETS_PER_POOL);
+    DescriptorAllocator(DescriptorAllocator&&) = default;
+    VkDescriptorSet allocate(VkDescriptorSetLayout layout);
+    void reset();
+    DescriptorAllocatorStats getStats();
+    void printStats(const std::string& name);
+};
+
+std::vector<DescriptorPoolRatio> getPoolRatios(const std::vector<VkDescriptorSetLayoutBinding>& bindings);
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "descriptor_allocator.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <vulkan/vulkan_core.h>
+
+class Device;
+
+// one write in a descriptor set, only the info matching the type is used
+struct DescriptorBinding {
+    uint32_t binding = 0;
+    VkDescriptorType type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    VkDescriptorBufferInfo buffer{};
+    VkDescriptorImageInfo image{};
+};
+
+// everything a descriptor set points at, two equal keys can share the same set
+struct DescriptorSetKey {
+    VkDescriptorSetLayout layout = VK_NULL_HANDLE;
+    std::vector<DescriptorBinding> bindings; // sorted by binding number
+
+    DescriptorSetKey& addBuffer(uint32_t binding, VkDescriptorType type, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range);
+    DescriptorSetKey& addImage(uint32_t binding, VkDescriptorType type, VkImageView view, VkSampler sampler, VkImageLayout imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    size_t hash() const;
+    bool operator==(const DescriptorSetKey& other) const;
+};
+
+struct DescriptorSetKeyHash {
+    size_t operator()(const DescriptorSetKey& key) const { return key.hash(); }
+};
+
+struct DescriptorCacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t updates = 0; // vkUpdateDescriptorSets calls
+    uint64_t evictions = 0;
+    uint64_t reused = 0; // misses served by a set freed by an eviction
+    size_t entries = 0;
+};
+
+// hands out a written descriptor set per distinct key, so sets pointing at the same resources are written once.
+// buffers, image views and samplers evict the sets that reference them when they are destroyed.
+// evicted sets are kept per layout and rewritten for a later miss once the gpu is done with them
+class DescriptorCache {
+private:
+    Device* device;
+    std::mutex mutex;
+    DescriptorAllocator allocator;
+    std::unordered_map<DescriptorSetKey, VkDescriptorSet, DescriptorSetKeyHash> sets;
+    std::unordered_set<uint64_t> referenced; // every handle some entry points at, most destroyed resources can skip the scan
+    std::unordered_map<VkDescriptorSetLayout, std::vector<VkDescriptorSet>> freeSets;
+    DescriptorCacheStats stats;
+    void write(VkDescriptorSet set, const DescriptorSetKey& key);
+public:
+    DescriptorCache(Device* device);
+    ~DescriptorCache();
+    VkDescriptorSet get(const DescriptorSetKey& key);
+    void evict(uint64_t handle);
+    DescriptorCacheStats getStats();
+    void printStats();
+};
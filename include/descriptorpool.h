@@ -1,14 +1,21 @@
 #pragma once
 
 #include "device.h"
+#include <cstdint>
 #include <vector>
 #include <vulkan/vulkan_core.h>
+// one fixed size pool, lives as long as the sets allocated from it. DescriptorAllocator chains these when it needs more
 class DescriptorPool {
 private:
     VkDescriptorPool pool;
     Device* device;
 public:
-    DescriptorPool(Device* device, std::vector<uint32_t> counts, std::vector<VkDescriptorType> types);
+    DescriptorPool(Device* device, const std::vector<VkDescriptorPoolSize>& poolSizes, uint32_t maxSets, VkDescriptorPoolCreateFlags flags = 0);
     ~DescriptorPool();
+    DescriptorPool(const DescriptorPool&) = delete;
+    DescriptorPool& operator=(const DescriptorPool&) = delete;
+    //VK_ERROR_OUT_OF_POOL_MEMORY or VK_ERROR_FRAGMENTED_POOL when the pool is full
+    VkResult allocate(VkDescriptorSetLayout layout, VkDescriptorSet* set);
+    void reset();
     VkDescriptorPool getHandle() { return pool; }
-};
\ No newline at end of file
+};
@@ -1,14 +1,31 @@
 #pragma once
 
+#include "memory_allocator.h"
 #include "surface.h"
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
 #include <optional>
 #include <vulkan/vulkan_core.h>
 #include <instance.h>
 #include <vector>
 
+class BindlessTable;
+class DescriptorCache;
+class LayoutCache;
+class PipelineCache;
+class PipelineCompiler;
+class ShaderLibrary;
+class StagingRing;
+class TimelineSemaphore;
+
 struct QueueFamilyIndices {
     std::optional<uint32_t> graphicsFamily;
     std::optional<uint32_t> presentFamily;
+    //only set when the device has families without graphics support, otherwise everything runs on the graphics queue
+    std::optional<uint32_t> transferFamily;
+    std::optional<uint32_t> computeFamily;
 
     bool isComplete() {
         return graphicsFamily.has_value() && presentFamily.has_value();
@@ -20,10 +37,31 @@ struct QueueFamilyIndices {
 };
 
 
+//only required when presenting to a surface
 const std::vector<const char*> deviceExtensions = {
     VK_KHR_SWAPCHAIN_EXTENSION_NAME
 };
 
+// pipeline state the device lets us set on the command buffer instead of baking into the pipeline,
+// each group is only set when its extension and feature are both there
+struct ExtendedDynamicState {
+    bool state1 = false; // cull mode, front face, topology, depth test/write/compare op
+    bool state2 = false; // primitive restart
+    bool polygonMode = false; // the rest are separate VK_EXT_extended_dynamic_state3 features
+    bool colorBlendEnable = false;
+    bool colorWriteMask = false;
+    PFN_vkCmdSetCullModeEXT setCullMode = nullptr;
+    PFN_vkCmdSetFrontFaceEXT setFrontFace = nullptr;
+    PFN_vkCmdSetPrimitiveTopologyEXT setPrimitiveTopology = nullptr;
+    PFN_vkCmdSetDepthTestEnableEXT setDepthTestEnable = nullptr;
+    PFN_vkCmdSetDepthWriteEnableEXT setDepthWriteEnable = nullptr;
+    PFN_vkCmdSetDepthCompareOpEXT setDepthCompareOp = nullptr;
+    PFN_vkCmdSetPrimitiveRestartEnableEXT setPrimitiveRestartEnable = nullptr;
+    PFN_vkCmdSetPolygonModeEXT setPolygonMode = nullptr;
+    PFN_vkCmdSetColorBlendEnableEXT setColorBlendEnable = nullptr;
+    PFN_vkCmdSetColorWriteMaskEXT setColorWriteMask = nullptr;
+};
+
 struct SwapChainSupportDetails {
     VkSurfaceCapabilitiesKHR capabilities;
     std::vector<VkSurfaceFormatKHR> formats;
@@ -35,17 +73,105 @@ private:
     Instance* instance;
     Surface* surface;
     VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+    VkPhysicalDeviceProperties properties;
+    VkPhysicalDeviceMemoryProperties memoryProperties;
     VkDevice device;
+    QueueFamilyIndices queueFamilies;
     VkQueue graphicsQueue;
     VkQueue presentQueue = VK_NULL_HANDLE;
+    VkQueue transferQueue = VK_NULL_HANDLE;
+    VkQueue computeQueue = VK_NULL_HANDLE;
+    std::unique_ptr<MemoryAllocator> allocator;
+    std::unique_ptr<StagingRing> stagingRing;
+    std::unique_ptr<LayoutCache> layoutCache;
+    std::unique_ptr<BindlessTable> bindlessTable;
+    std::unique_ptr<DescriptorCache> descriptorCache;
+    std::unique_ptr<ShaderLibrary> shaderLibrary;
+    std::unique_ptr<PipelineCache> pipelineCache;
+    std::unique_ptr<PipelineCompiler> pipelineCompiler;
+    std::unique_ptr<TimelineSemaphore> graphicsTimeline;
+    std::unique_ptr<TimelineSemaphore> transferTimeline;
+    std::unique_ptr<TimelineSemaphore> computeTimeline;
+    bool dynamicRendering = false;
+    bool swapchainMaintenance1 = false;
+    PFN_vkCmdBeginRenderingKHR cmdBeginRendering = nullptr;
+    PFN_vkCmdEndRenderingKHR cmdEndRendering = nullptr;
+    ExtendedDynamicState extendedDynamicState;
+
+    struct DeferredDelete {
+        uint64_t graphicsValue;
+        std::function<void()> destroy;
+    };
+    std::deque<DeferredDelete> deferredDeletes;
+
+    //presents aren't on the graphics timeline, objects they use are retired by present count instead
+    struct PresentDelete {
+        uint64_t presentCount;
+        std::function<void()> destroy;
+    };
+    struct FramePresents {
+        uint64_t graphicsValue;
+        uint64_t presentCount;
+    };
+    std::deque<PresentDelete> presentDeletes;
+    std::deque<FramePresents> framePresents;
+    uint64_t presentsQueued = 0;
+    uint64_t presentsCompleted = 0;
+    void loadExtendedDynamicState();
 public:
     Device(Instance* instance, Surface* surface = nullptr);
     ~Device();
     void waitIdle();
     VkQueue getGraphicsQueue() { return graphicsQueue; }
     VkQueue getPresentQueue() { return presentQueue; }
+    VkQueue getTransferQueue() { return transferQueue; }
+    VkQueue getComputeQueue() { return computeQueue; }
+    uint32_t getTransferFamily() { return queueFamilies.transferFamily.value_or(queueFamilies.graphicsFamily.value()); }
+    uint32_t getComputeFamily() { return queueFamilies.computeFamily.value_or(queueFamilies.graphicsFamily.value()); }
+    bool hasDedicatedTransferQueue() { return queueFamilies.transferFamily.has_value(); }
+    bool hasAsyncComputeQueue() { return queueFamilies.computeFamily.has_value(); }
+    bool hasDynamicRendering() { return dynamicRendering; }
+    //presents can signal a fence, so the swapchain knows exactly when one is done with its semaphores and images
+    bool hasSwapchainMaintenance1() { return swapchainMaintenance1; }
+    PFN_vkCmdBeginRenderingKHR getCmdBeginRendering() { return cmdBeginRendering; }
+    PFN_vkCmdEndRenderingKHR getCmdEndRendering() { return cmdEndRendering; }
+    const ExtendedDynamicState& getExtendedDynamicState() { return extendedDynamicState; }
     VkDevice getDevice() { return device; }
     VkPhysicalDevice getPhysicalDevices() { return physicalDevice; }
+    const VkPhysicalDeviceProperties& getProperties() { return properties; }
+    const VkPhysicalDeviceMemoryProperties& getMemoryProperties() { return memoryProperties; }
     SwapChainSupportDetails getSwapChainDetails();
     QueueFamilyIndices getQueueFamilies();
+    MemoryAllocator* getAllocator() { return allocator.get(); }
+    StagingRing* getStagingRing() { return stagingRing.get(); }
+    LayoutCache* getLayoutCache() { return layoutCache.get(); }
+    BindlessTable* getBindlessTable() { return bindlessTable.get(); }
+    //null before the cache is created and after it is destroyed, resources owned by the device outlive it
+    DescriptorCache* getDescriptorCache() { return descriptorCache.get(); }
+    ShaderLibrary* getShaderLibrary() { return shaderLibrary.get(); }
+    PipelineCache* getPipelineCache() { return pipelineCache.get(); }
+    PipelineCompiler* getPipelineCompiler() { return pipelineCompiler.get(); }
+    //one timeline per queue, the transfer and compute ones are the graphics timeline when there is no dedicated queue
+    TimelineSemaphore* getGraphicsTimeline() { return graphicsTimeline.get(); }
+    TimelineSemaphore* getTransferTimeline() { return transferTimeline ? transferTimeline.get() : graphicsTimeline.get(); }
+    TimelineSemaphore* getComputeTimeline() { return computeTimeline ? computeTimeline.get() : graphicsTimeline.get(); }
+
+    //keeps the object alive until the graphics timeline reaches everything submitted so far
+    template<typename T>
+    void defer(std::unique_ptr<T> object) {
+        T* raw = object.release();
+        deferDestroy([raw]() { delete raw; });
+    }
+    void deferDestroy(std::function<void()> destroy);
+    //for objects a queued present may still use, the retired swapchain and the semaphores presents wait on.
+    //destroyed once every present queued so far is done
+    void deferPresentDestroy(std::function<void()> destroy);
+    //counts a present, returns its number for completePresents
+    uint64_t queuePresent() { return ++presentsQueued; }
+    //with swapchain maintenance1, called as present fences signal
+    void completePresents(uint64_t presentCount);
+    //without it, a frame's graphics work finishing means the presents queued before it were processed, they run in order.
+    //called with each frame's point once it is reserved
+    void trackFramePresents(uint64_t graphicsValue);
+    void collectGarbage();
 };
\ No newline at end of file
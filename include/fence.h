@@ -11,5 +11,6 @@ public:
     ~Fence();
     void wait();
     void reset();
+    bool isSignaled();
     VkFence getHandle() { return fence; }
 };
\ No newline at end of file
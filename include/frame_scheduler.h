@@ -0,0 +1,32 @@
+#pragma once
+
+#include "device.h"
+#include "semaphore.h"
+#include "timeline_semaphore.h"
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <vulkan/vulkan_core.h>
+
+// paces frames in flight with the graphics timeline instead of a fence per frame.
+// every frame reserves the next timeline value for its submission, a frame slot is reused once its last value is reached
+class FrameScheduler {
+private:
+    Device* device;
+    uint32_t framesInFlight;
+    uint32_t currentFrame = 0;
+    std::vector<uint64_t> frameValues;
+    // acquire and present only take binary semaphores
+    std::vector<std::unique_ptr<Semaphore>> imageAvailableSemaphores;
+    std::vector<std::unique_ptr<Semaphore>> renderFinishedSemaphores;
+public:
+    FrameScheduler(Device* device, uint32_t framesInFlight, size_t swapchainImageCount);
+    uint32_t beginFrame();
+    TimelinePoint reserveFramePoint();
+    void endFrame();
+    void setSwapchainImageCount(size_t count);
+    uint32_t getCurrentFrame() { return currentFrame; }
+    uint32_t getFramesInFlight() { return framesInFlight; }
+    Semaphore* getImageAvailable() { return imageAvailableSemaphores[currentFrame].get(); }
+    Semaphore* getRenderFinished(uint32_t imageIndex) { return renderFinishedSemaphores[imageIndex].get(); }
+};
@@ -1,11 +1,26 @@
 #pragma once
 
 #include <array>
+#include <cstdint>
 #include <glm/ext/matrix_float4x4.hpp>
 #include <glm/glm.hpp>
+#include <map>
+#include <string>
 #include <vulkan/vulkan_core.h>
 
-const int MAX_FRAMES_IN_FLIGHT = 2;
+//upper bound for RenderConfig::framesInFlight
+const int MAX_FRAMES_IN_FLIGHT = 4;
+
+//latency/throughput policy, picked at startup instead of compiled in
+struct RenderConfig {
+    uint32_t framesInFlight = 2;
+    VkPresentModeKHR presentMode = VK_PRESENT_MODE_MAILBOX_KHR; // falls back to FIFO when the surface doesn't support it
+    uint32_t swapchainImageCount = 0; // 0 = one more than the surface minimum, clamped to what the surface allows
+    bool watchShaders = false; // development mode, edited shaders are recompiled and swapped in while running
+    std::map<std::string, uint32_t> specialization; // shader permutation, specialization constant name -> value
+    bool dynamicRendering = true; // use VK_KHR_dynamic_rendering when the device has it, render passes otherwise
+    bool extendedDynamicState = false; // move rasterizer/depth/blend state the device supports out of the pipeline and into the command buffer
+};
 
 struct Vertex {
     glm::vec2 pos;
@@ -44,8 +59,25 @@ struct Vertex {
     }
 };
 
-struct UniformBufferObject {
-    alignas(16) glm::mat4 model;
+//camera, written once per frame and shared by every draw in it
+struct FrameUniforms {
     alignas(16) glm::mat4 view;
     alignas(16) glm::mat4 proj;
 };
+
+//per draw push constants, the object's transform and indices into the device's bindless table.
+//72 bytes, well inside the 128 every device supports
+struct DrawConstants {
+    glm::mat4 model;
+    uint32_t textureIndex;
+    uint32_t samplerIndex;
+};
+
+//per instance vertex stream, binding 1. locations from FIRST_INSTANCE_LOCATION up in basic.vert, the mat4 takes four
+const uint32_t FIRST_INSTANCE_LOCATION = 3;
+
+struct InstanceData {
+    glm::mat4 transform; // applied before DrawConstants::model
+    glm::vec4 color; // multiplied into the sampled color
+    uint32_t textureIndex; // added to DrawConstants::textureIndex
+};
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "commandbuffer.h"
+#include "device.h"
+#include <cstdint>
+#include <vector>
+#include <vulkan/vulkan_core.h>
+
+// gpu time of a frame's command buffer from a pair of timestamp queries per frame in flight.
+// a frame's result is read when its slot is recorded again, so it lags by the number of frames in flight.
+// every result read is added to a running total, averages should come from the total and count, not the last value
+class GpuTimer {
+private:
+    Device* device;
+    VkQueryPool pool = VK_NULL_HANDLE;
+    uint32_t frameCount;
+    uint64_t validMask;
+    double nanosecondsPerTick;
+    std::vector<bool> written;
+    double lastMilliseconds = 0.0;
+    double totalMilliseconds = 0.0;
+    uint64_t resultCount = 0;
+    void readResult(uint32_t frame, bool wait);
+public:
+    GpuTimer(Device* device, uint32_t frameCount);
+    ~GpuTimer();
+    //begin has to be recorded outside a render pass, it resets the frame's queries
+    void begin(CommandBuffer* buffer, uint32_t frame);
+    void end(CommandBuffer* buffer, uint32_t frame);
+    //blocks for the results of frames that were submitted but not read yet
+    void drain();
+    //drops the totals and the results still in flight, so only frames recorded from here on are counted
+    void resetStats();
+    bool isSupported() { return pool != VK_NULL_HANDLE; }
+    double getLastMilliseconds() { return lastMilliseconds; }
+    double getTotalMilliseconds() { return totalMilliseconds; }
+    uint64_t getResultCount() { return resultCount; }
+};
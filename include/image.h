@@ -1,21 +1,25 @@
 #pragma once
 
 #include "buffer.h"
-#include "commandpool.h"
+#include "commandbuffer.h"
 #include "device.h"
+#include "memory_allocator.h"
 #include <vulkan/vulkan_core.h>
 class Image {
 private:
     VkImage image;
-    VkDeviceMemory imageMemory;
+    Allocation allocation;
     VkFormat currentFormat;
     VkImageLayout currentLayout;
     Device* device;
-    CommandPool cmdPool;
 public:
-    Image(Device* device, uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties);
+    Image(Device* device, uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, MemoryUsage memoryUsage = MEMORY_USAGE_GPU_ONLY);
     ~Image();
-    void transitionImageLayout(VkImageLayout newLayout);
-    void bufferToImage(Buffer* buffer, uint32_t width, uint32_t height);
+    void transitionImageLayout(CommandBuffer* cmdBuffer, VkImageLayout newLayout);
+    void releaseOwnership(CommandBuffer* cmdBuffer, VkImageLayout newLayout, uint32_t srcFamily, uint32_t dstFamily);
+    void acquireOwnership(CommandBuffer* cmdBuffer, VkImageLayout newLayout, uint32_t srcFamily, uint32_t dstFamily);
+    void bufferToImage(CommandBuffer* cmdBuffer, Buffer* buffer, uint32_t width, uint32_t height, VkDeviceSize bufferOffset = 0);
     VkImage getHandle() { return image; }
+    VkImageLayout getLayout() { return currentLayout; }
+    VkFormat getFormat() { return currentFormat; }
 };
\ No newline at end of file
@@ -8,11 +8,13 @@ class Instance {
 private:
     VkInstance instance;
     VkDebugUtilsMessengerEXT debugMessenger;
+    bool surfaceMaintenance1 = false;
 public:
-    Instance(const char* appName, uint32_t appVersion, uint32_t apiVersion = VK_API_VERSION_1_0);
+    Instance(const char* appName, uint32_t appVersion, uint32_t apiVersion = VK_API_VERSION_1_0, bool headless = false);
     ~Instance();
 
     VkInstance getInstance() { return instance; }
+    bool hasSurfaceMaintenance1() { return surfaceMaintenance1; }
 private:
     void setupDebugMessenger();
 };
\ No newline at end of file
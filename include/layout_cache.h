@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include <vulkan/vulkan_core.h>
+
+class Device;
+
+// one slot of the data passed to vkUpdateDescriptorSetWithTemplate, templates from the cache read one per descriptor
+union DescriptorInfo {
+    VkDescriptorBufferInfo buffer;
+    VkDescriptorImageInfo image;
+};
+
+// writes a whole set in one call, slot i of the data goes to bindings[i]
+struct UpdateTemplate {
+    VkDescriptorUpdateTemplate handle = VK_NULL_HANDLE;
+    std::vector<uint32_t> bindings; // binding number of each slot, a binding with a descriptor count of n takes n slots
+};
+
+// hands out one descriptor set layout per distinct set of bindings, and one pipeline layout per distinct
+// combination of set layouts and push constants. sharing them keeps descriptor sets compatible between
+// pipelines, so switching pipelines doesn't force the sets to be bound again
+class LayoutCache {
+private:
+    struct SetLayoutKey {
+        std::vector<VkDescriptorSetLayoutBinding> bindings;
+        bool operator==(const SetLayoutKey& other) const;
+    };
+    struct SetLayoutKeyHash {
+        size_t operator()(const SetLayoutKey& key) const;
+    };
+    struct PipelineLayoutKey {
+        std::vector<VkDescriptorSetLayout> setLayouts;
+        std::vector<VkPushConstantRange> pushConstantRanges;
+        bool operator==(const PipelineLayoutKey& other) const;
+    };
+    struct PipelineLayoutKeyHash {
+        size_t operator()(const PipelineLayoutKey& key) const;
+    };
+
+    Device* device;
+    std::mutex mutex;
+    std::unordered_map<SetLayoutKey, VkDescriptorSetLayout, SetLayoutKeyHash> setLayouts;
+    std::unordered_map<PipelineLayoutKey, VkPipelineLayout, PipelineLayoutKeyHash> pipelineLayouts;
+    std::unordered_map<VkDescriptorSetLayout, std::vector<VkDescriptorSetLayoutBinding>> layoutBindings;
+    std::unordered_map<VkDescriptorSetLayout, UpdateTemplate> updateTemplates;
+public:
+    LayoutCache(Device* device);
+    ~LayoutCache();
+    VkDescriptorSetLayout getSetLayout(const std::vector<VkDescriptorSetLayoutBinding>& bindings);
+    //built the first time it is asked for, layouts the cache didn't create get an empty template
+    const UpdateTemplate& getUpdateTemplate(VkDescriptorSetLayout setLayout);
+    VkPipelineLayout getPipelineLayout(const std::vector<VkDescriptorSetLayout>& setLayouts, const std::vector<VkPushConstantRange>& pushConstantRanges);
+};
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "memory_util.h"
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <vulkan/vulkan_core.h>
+
+class Device;
+class MemoryBlock;
+
+const VkDeviceSize DEFAULT_MEMORY_BLOCK_SIZE = 64 * 1024 * 1024;
+
+struct Allocation {
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkDeviceSize offset = 0;
+    VkDeviceSize size = 0;
+    void* mapped = nullptr;
+    uint32_t memoryType = 0;
+
+    //range actually reserved in the block, includes alignment padding in front of offset
+    MemoryBlock* block = nullptr;
+    VkDeviceSize rangeOffset = 0;
+    VkDeviceSize rangeSize = 0;
+};
+
+struct MemoryStats {
+    uint32_t deviceMemoryCount = 0; // live vkAllocateMemory handles
+    uint64_t allocationCount = 0; // live sub allocations
+    VkDeviceSize bytesReserved = 0; // total size of all device memory blocks
+    VkDeviceSize bytesUsed = 0; // bytes handed out to resources
+    VkDeviceSize bytesWasted = 0; // alignment padding that can't be used by anyone
+    float fragmentation = 0.0f; // 0 = all free space is one range, close to 1 = free space is scattered
+};
+
+// one vkAllocateMemory call, carved into aligned ranges tracked with a free list
+class MemoryBlock {
+private:
+    Device* device;
+    VkDeviceMemory memory;
+    VkDeviceSize size;
+    uint32_t memoryType;
+    void* mapped = nullptr;
+    std::map<VkDeviceSize, VkDeviceSize> freeRanges; // offset -> size
+    uint64_t allocationCount = 0;
+    bool dedicated;
+public:
+    MemoryBlock(Device* device, uint32_t memoryType, VkDeviceSize size, bool hostVisible, bool dedicated);
+    ~MemoryBlock();
+    bool allocate(VkDeviceSize size, VkDeviceSize alignment, Allocation& allocation);
+    void free(const Allocation& allocation);
+    bool isEmpty() { return allocationCount == 0; }
+    bool isDedicated() { return dedicated; }
+    VkDeviceSize getSize() { return size; }
+    uint64_t getAllocationCount() { return allocationCount; }
+    VkDeviceSize getFreeBytes();
+    VkDeviceSize getLargestFreeRange();
+};
+
+class MemoryAllocator {
+private:
+    Device* device;
+    VkDeviceSize blockSize;
+    VkDeviceSize bufferImageGranularity;
+    uint32_t maxAllocationCount;
+    // pools are indexed by memory type * 2 + 1 for optimal tiling images, only split when bufferImageGranularity requires it
+    std::vector<std::vector<std::unique_ptr<MemoryBlock>>> pools;
+    std::mutex mutex;
+    uint32_t deviceMemoryCount = 0;
+    uint64_t allocationCount = 0;
+    VkDeviceSize bytesUsed = 0;
+    VkDeviceSize bytesWasted = 0;
+public:
+    MemoryAllocator(Device* device, VkDeviceSize blockSize = DEFAULT_MEMORY_BLOCK_SIZE);
+    ~MemoryAllocator();
+    Allocation allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, MemoryUsage usage = MEMORY_USAGE_UNKNOWN, bool linear = true);
+    void free(Allocation& allocation);
+    void flush(const Allocation& allocation);
+    void invalidate(const Allocation& allocation);
+    MemoryStats getStats();
+    void printStats();
+private:
+    std::vector<std::unique_ptr<MemoryBlock>>& getPool(uint32_t memoryType, bool linear);
+    MemoryBlock* createBlock(uint32_t memoryType, VkDeviceSize size, bool dedicated);
+    bool isCoherent(uint32_t memoryType);
+};
@@ -1,4 +1,17 @@
 #pragma once
 
-#include "device.h"
-uint32_t findMemoryType(Device* device, uint32_t typeFilter, VkMemoryPropertyFlags properties);
\ No newline at end of file
+#include <cstdint>
+#include <vulkan/vulkan_core.h>
+
+class Device;
+
+enum MemoryUsage {
+    MEMORY_USAGE_UNKNOWN, // only the required flags are considered
+    MEMORY_USAGE_GPU_ONLY, // written by transfers or shaders, never touched by the cpu
+    MEMORY_USAGE_UPLOAD, // written once by the cpu and copied by the gpu, ie staging buffers
+    MEMORY_USAGE_READBACK, // written by the gpu and read back on the cpu
+    MEMORY_USAGE_DYNAMIC // rewritten by the cpu every frame and read directly by the gpu
+};
+
+uint32_t findMemoryType(Device* device, uint32_t typeFilter, VkMemoryPropertyFlags properties);
+uint32_t findMemoryType(Device* device, uint32_t typeFilter, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred, MemoryUsage usage);
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "buffer.h"
+#include "commandbuffer.h"
+#include "device.h"
+#include "image.h"
+#include "imageview.h"
+#include "render_target.h"
+#include "timeline_semaphore.h"
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+#include <vulkan/vulkan_core.h>
+
+struct ReadbackFrame {
+    uint64_t frameNumber;
+    const void* data;
+    VkDeviceSize size;
+    VkExtent2D extent;
+    VkFormat format;
+};
+
+// renders into plain images instead of a swapchain, no window or display needed.
+// every image has a host cached readback buffer it is copied into at the end of the frame,
+// finished copies are handed to the readback callback later without waiting on the gpu
+class OffscreenTarget : public RenderTarget {
+private:
+    struct Slot {
+        std::unique_ptr<Image> image;
+        std::unique_ptr<ImageView> view;
+        std::unique_ptr<Buffer> readback;
+        TimelinePoint point;
+        uint64_t frameNumber = 0;
+        bool pending = false;
+    };
+
+    Device* device;
+    VkExtent2D extent;
+    VkFormat format;
+    std::vector<Slot> slots;
+    uint32_t imageIndex = 0;
+    uint64_t frameCount = 0;
+    uint64_t readbackCount = 0;
+    std::function<void(const ReadbackFrame&)> readbackCallback;
+public:
+    OffscreenTarget(Device* device, VkExtent2D extent, uint32_t imageCount, VkFormat format = VK_FORMAT_R8G8B8A8_SRGB);
+    ~OffscreenTarget() override;
+    bool swap(Semaphore* semaphore = nullptr) override;
+    bool present(std::vector<Semaphore*> waitSemaphores = {}) override;
+    void recordFinish(CommandBuffer* cmdBuffer, TimelinePoint signal) override;
+    uint32_t getImageIndex() override { return imageIndex; }
+    VkExtent2D getExtent() override { return extent; }
+    VkFormat getFormat() override { return format; }
+    size_t getImageCount() override { return slots.size(); }
+    VkImage getImage(size_t index) override { return slots[index].image->getHandle(); }
+    ImageView* getImageView(size_t index) override { return slots[index].view.get(); }
+    VkImageLayout getFinalLayout() override { return VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL; }
+    void setReadbackCallback(std::function<void(const ReadbackFrame&)> callback) { readbackCallback = callback; }
+    uint32_t collectReadbacks();
+    void flushReadbacks();
+    uint64_t getReadbackCount() { return readbackCount; }
+private:
+    void deliver(Slot& slot);
+};
@@ -2,20 +2,21 @@
 
 #include "commandbuffer.h"
 #include "device.h"
-#include "swapchain.h"
-#include <vector>
+#include "pipeline_key.h"
+#include <cstdint>
 #include <vulkan/vulkan_core.h>
+
 class Pipeline {
 private:
     VkPipeline pipeline;
     Device* device;
     VkPipelineLayout layout;
-    VkRenderPass renderPass;
-    VkDescriptorSetLayout descriptorSetLayout;
+    uint32_t dynamicState;
 public:
-    Pipeline(Device* device, const std::vector<const char*> shaderFiles, SwapChain* swapchain, VkRenderPass renderPass);
+    Pipeline(Device* device, const PipelineKey& key, VkPipelineCache cache = VK_NULL_HANDLE);
     ~Pipeline();
-    VkDescriptorSetLayout getDescriptorSetLayout() { return descriptorSetLayout; }
+    VkPipeline getHandle() { return pipeline; }
     VkPipelineLayout getPipelineLayout() { return layout; }
+    uint32_t getDynamicState() { return dynamicState; }
     void bind(CommandBuffer* buffer);
-};
\ No newline at end of file
+};
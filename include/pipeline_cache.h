@@ -0,0 +1,34 @@
+#pragma once
+
+#include "device.h"
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vulkan/vulkan_core.h>
+
+const char* const DEFAULT_PIPELINE_CACHE_PATH = "pipeline_cache.bin";
+
+// VkPipelineCache that persists between runs. data from another driver or gpu is thrown away on load,
+// threads compiling pipelines get their own cache which is merged back in when they are done
+class PipelineCache {
+private:
+    Device* device;
+    VkPipelineCache cache = VK_NULL_HANDLE;
+    std::string path;
+    bool warm = false;
+    std::mutex mutex;
+    uint32_t pipelineCount = 0;
+    double creationMilliseconds = 0.0;
+public:
+    PipelineCache(Device* device, const std::string& path = DEFAULT_PIPELINE_CACHE_PATH);
+    ~PipelineCache();
+    VkPipelineCache getHandle() { return cache; }
+    VkPipelineCache createWorkerCache();
+    void merge(VkPipelineCache workerCache);
+    void save();
+    bool isWarm() { return warm; }
+    void recordCreation(double milliseconds);
+    void printStats();
+private:
+    bool validateHeader(const std::string& data);
+};
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "device.h"
+#include "pipeline.h"
+#include "pipeline_key.h"
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <vulkan/vulkan_core.h>
+
+// result of a queued compile, poll it from the render thread and draw once it is ready
+class PipelineHandle {
+private:
+    std::unique_ptr<Pipeline> pipeline;
+    std::string error;
+    std::promise<void> promise;
+    std::shared_future<void> done;
+    friend class PipelineCompiler;
+public:
+    PipelineHandle() : done(promise.get_future().share()) {}
+    bool isReady();
+    void wait();
+    Pipeline* get();
+};
+
+// compiles pipelines on a pool of worker threads, each with its own pipeline cache merged back into the device one.
+// equal keys share one handle, so a permutation is only ever compiled once
+class PipelineCompiler {
+private:
+    struct Job {
+        PipelineKey key;
+        std::shared_ptr<PipelineHandle> handle;
+    };
+
+    Device* device;
+    std::vector<std::thread> workers;
+    std::deque<Job> jobs;
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::unordered_map<PipelineKey, std::shared_ptr<PipelineHandle>, PipelineKeyHash> pipelines;
+    bool stopping = false;
+    uint32_t compiledCount = 0;
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+public:
+    PipelineCompiler(Device* device, uint32_t threadCount = 0);
+    ~PipelineCompiler();
+    std::shared_ptr<PipelineHandle> compile(const PipelineKey& requested);
+    std::shared_ptr<PipelineHandle> recompile(const PipelineKey& requested);
+    void retire(std::shared_ptr<PipelineHandle> handle);
+    void releaseRenderPass(VkRenderPass renderPass);
+    uint32_t getThreadCount() { return static_cast<uint32_t>(workers.size()); }
+    uint32_t getCompiledCount();
+    uint64_t getHitCount();
+    uint64_t getMissCount();
+    void printStats();
+private:
+    void workerLoop();
+};
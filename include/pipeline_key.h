@@ -0,0 +1,79 @@
+#pragma once
+
+#include "shader_reflection.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <vulkan/vulkan_core.h>
+
+class Device;
+
+// state a key can leave to the command buffer, needs the matching ExtendedDynamicState support on the device
+enum PipelineDynamicState : uint32_t {
+    DYNAMIC_STATE_CULL_MODE = 1 << 0,
+    DYNAMIC_STATE_FRONT_FACE = 1 << 1,
+    DYNAMIC_STATE_TOPOLOGY = 1 << 2, // within the same primitive class, triangles stay triangles
+    DYNAMIC_STATE_DEPTH = 1 << 3, // test, write and compare op
+    DYNAMIC_STATE_PRIMITIVE_RESTART = 1 << 4,
+    DYNAMIC_STATE_POLYGON_MODE = 1 << 5,
+    DYNAMIC_STATE_BLEND_ENABLE = 1 << 6,
+    DYNAMIC_STATE_COLOR_WRITE_MASK = 1 << 7
+};
+
+uint32_t getSupportedDynamicState(Device* device);
+
+// everything that changes the compiled pipeline, held by value so it can be compiled on another thread.
+// two equal keys always produce the same pipeline, the compiler hands out one VkPipeline per key
+struct PipelineKey {
+    std::vector<std::string> shaderFiles;
+    std::vector<SpecializationConstant> specialization; // sorted by constant id, see PipelineLayout::resolveSpecialization
+
+    //vertex layout
+    std::vector<VkVertexInputBindingDescription> vertexBindings;
+    std::vector<VkVertexInputAttributeDescription> vertexAttributes;
+    VkPrimitiveTopology topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    bool primitiveRestart = false;
+
+    //rasterizer
+    VkPolygonMode polygonMode = VK_POLYGON_MODE_FILL;
+    VkCullModeFlags cullMode = VK_CULL_MODE_BACK_BIT;
+    VkFrontFace frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+    VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+
+    //depth, ignored by render passes without a depth attachment
+    bool depthTest = false;
+    bool depthWrite = false;
+    VkCompareOp depthCompareOp = VK_COMPARE_OP_LESS;
+
+    //color blending
+    bool blendEnable = true;
+    VkBlendFactor srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+    VkBlendFactor dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+    VkBlendOp colorBlendOp = VK_BLEND_OP_ADD;
+    VkBlendFactor srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+    VkBlendFactor dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+    VkBlendOp alphaBlendOp = VK_BLEND_OP_ADD;
+    VkColorComponentFlags colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+
+    //render pass compatibility, the handle stands in for its attachment formats and sample counts.
+    //without a render pass the pipeline is built for dynamic rendering with just the attachment formats
+    VkRenderPass renderPass = VK_NULL_HANDLE;
+    uint32_t subpass = 0;
+    std::vector<VkFormat> colorFormats;
+    VkFormat depthFormat = VK_FORMAT_UNDEFINED;
+    VkPipelineLayout layout = VK_NULL_HANDLE;
+
+    //PipelineDynamicState bits. the values above still say what to draw with, the command buffer sets them per draw
+    uint32_t dynamicState = 0;
+
+    //copy with the dynamic fields reset, so keys that only differ in dynamic state share a pipeline
+    PipelineKey canonical() const;
+    size_t hash() const;
+    bool operator==(const PipelineKey& other) const;
+    bool operator!=(const PipelineKey& other) const { return !(*this == other); }
+};
+
+struct PipelineKeyHash {
+    size_t operator()(const PipelineKey& key) const { return key.hash(); }
+};
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "device.h"
+#include "shader_reflection.h"
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+#include <vulkan/vulkan_core.h>
+
+const uint32_t NO_INSTANCE_INPUTS = UINT32_MAX;
+
+// descriptor set layouts and pipeline layout for a set of shaders, built from their spir-v.
+// the handles come from the device's layout cache, so equal layouts are the same handle and nothing is destroyed here.
+// BINDLESS_SET always uses the bindless table's layout
+class PipelineLayout {
+private:
+    VkPipelineLayout layout;
+    std::vector<VkDescriptorSetLayout> setLayouts;
+    PipelineReflection reflection;
+public:
+    //dynamicUniforms binds every reflected uniform buffer as UNIFORM_BUFFER_DYNAMIC, for data from a UniformAllocator.
+    //vertex inputs from firstInstanceLocation up are read per instance from binding 1, see splitInstanceInputs
+    PipelineLayout(Device* device, const std::vector<std::string>& shaderFiles, bool dynamicUniforms = false, uint32_t firstInstanceLocation = NO_INSTANCE_INPUTS);
+    PipelineLayout(Device* device, const std::vector<VkDescriptorSetLayoutBinding>& bindings);
+    VkPipelineLayout getHandle() { return layout; }
+    VkDescriptorSetLayout getDescriptorSetLayout(uint32_t set = 0) { return setLayouts.at(set); }
+    uint32_t getSetCount() { return static_cast<uint32_t>(setLayouts.size()); }
+    const std::vector<VkDescriptorSetLayoutBinding>& getBindings(uint32_t set = 0) { return reflection.sets.at(set); }
+    const std::vector<VkPushConstantRange>& getPushConstantRanges() { return reflection.pushConstantRanges; }
+    const std::vector<VkVertexInputBindingDescription>& getVertexBindings() { return reflection.vertexBindings; }
+    const std::vector<VkVertexInputAttributeDescription>& getVertexAttributes() { return reflection.vertexAttributes; }
+    std::vector<SpecializationConstant> resolveSpecialization(const std::map<std::string, uint32_t>& values);
+private:
+    void createLayouts(Device* device);
+    VkDescriptorSetLayout getBindlessLayout(Device* device);
+};
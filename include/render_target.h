@@ -0,0 +1,30 @@
+#pragma once
+
+#include "commandbuffer.h"
+#include "imageview.h"
+#include "timeline_semaphore.h"
+#include <cstdint>
+#include <semaphore.h>
+#include <vector>
+#include <vulkan/vulkan_core.h>
+
+// a set of color images the renderer draws into, either a swapchain or offscreen images that are read back
+class RenderTarget {
+public:
+    virtual ~RenderTarget() {}
+    //picks the image for the next frame, signals the semaphore once it can be written. false means the target has to be recreated
+    virtual bool swap(Semaphore* semaphore = nullptr) = 0;
+    //hands the current image off once the semaphores signal. false means the target has to be recreated
+    virtual bool present(std::vector<Semaphore*> waitSemaphores = {}) = 0;
+    //called after the render pass ends, for work on the finished image that has to be in the same submission.
+    //signal is the point that submission will signal
+    virtual void recordFinish(CommandBuffer*, TimelinePoint) {}
+    virtual uint32_t getImageIndex() = 0;
+    virtual VkExtent2D getExtent() = 0;
+    virtual VkFormat getFormat() = 0;
+    virtual size_t getImageCount() = 0;
+    virtual VkImage getImage(size_t index) = 0;
+    virtual ImageView* getImageView(size_t index) = 0;
+    //layout the image is left in at the end of the frame, before recordFinish
+    virtual VkImageLayout getFinalLayout() = 0;
+};
@@ -1,14 +1,24 @@
 #pragma once
 
 #include "device.h"
+#include "shader_reflection.h"
+#include <cstddef>
+#include <cstdint>
+#include <map>
 #include <string>
 #include <vulkan/vulkan_core.h>
+
+// one shader module and its reflection, created through the device's ShaderLibrary so modules are shared
 class Shader {
 private:
     VkShaderModule shaderModule;
     Device* device;
+    ShaderReflection reflection;
 public:
-    Shader(Device* device, const std::string& filename);
+    Shader(Device* device, const uint32_t* code, size_t wordCount);
     ~Shader();
     VkShaderModule getShader() { return shaderModule; }
-};
\ No newline at end of file
+    VkShaderStageFlagBits getStage() { return reflection.stage; }
+    const ShaderReflection& getReflection() { return reflection; }
+    const std::map<std::string, SpecializationConstant>& getSpecializationConstants() { return reflection.specializationConstants; }
+};
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "shader.h"
+#include <cstdint>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <sys/types.h>
+#include <unordered_map>
+#include <vector>
+#include <vulkan/vulkan_core.h>
+
+class Device;
+
+struct ShaderLibraryStats {
+    uint64_t requests = 0; // calls to load
+    uint64_t fileHits = 0; // file unchanged since it was last loaded, not read again
+    uint64_t contentHits = 0; // file read but its spir-v matched a module already loaded
+    uint64_t modulesCreated = 0;
+    uint64_t bytesMapped = 0;
+    double loadMilliseconds = 0.0;
+};
+
+// owns every shader module on the device. files are memory mapped and hashed, modules are shared by content,
+// so pipelines built from the same .spv reuse one module and one reflection. the hash only picks the bucket,
+// a module is reused once its code compares equal to the file it was created from
+class ShaderLibrary {
+private:
+    struct FileEntry {
+        uint64_t hash;
+        off_t size;
+        timespec modified;
+        std::shared_ptr<Shader> shader;
+    };
+
+    //the file the module was created from, mapped again to compare against on a hash hit
+    struct ModuleEntry {
+        std::string path;
+        off_t size;
+        timespec modified;
+        std::shared_ptr<Shader> shader;
+    };
+
+    Device* device;
+    std::mutex mutex;
+    std::unordered_map<std::string, FileEntry> files;
+    std::unordered_map<uint64_t, std::vector<ModuleEntry>> modules; // content hash -> modules with that hash
+    ShaderLibraryStats stats;
+public:
+    ShaderLibrary(Device* device);
+    ~ShaderLibrary();
+    std::shared_ptr<Shader> load(const std::string& filename);
+    ShaderLibraryStats getStats();
+    void printStats();
+private:
+    void dropModule(const std::string& path, uint64_t hash, const std::shared_ptr<Shader>& shader);
+};
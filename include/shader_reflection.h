@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+#include <vulkan/vulkan_core.h>
+
+// one specialization constant value for the stages that declare it, bools are 0 or 1
+struct SpecializationConstant {
+    VkShaderStageFlags stages = VK_SHADER_STAGE_ALL;
+    uint32_t constantID = 0;
+    uint32_t value = 0;
+};
+
+struct ReflectedBinding {
+    uint32_t set = 0;
+    VkDescriptorSetLayoutBinding binding{};
+};
+
+// what one spir-v module expects from the pipeline, read straight from the module's decorations
+struct ShaderReflection {
+    VkShaderStageFlagBits stage = VK_SHADER_STAGE_ALL;
+    std::vector<ReflectedBinding> bindings;
+    uint32_t pushConstantSize = 0; // 0 = no push constant block
+    std::vector<VkVertexInputAttributeDescription> vertexInputs; // locations and formats only, offsets are filled in by mergeReflections
+    std::vector<uint32_t> vertexInputSizes;
+    std::map<std::string, SpecializationConstant> specializationConstants; // name -> id and default value
+};
+
+// the combined interface of every stage in a pipeline
+struct PipelineReflection {
+    std::map<uint32_t, std::vector<VkDescriptorSetLayoutBinding>> sets; // set -> bindings sorted by binding number
+    std::vector<VkPushConstantRange> pushConstantRanges;
+    //vertex inputs are assumed to be one interleaved binding, packed in location order. splitInstanceInputs moves the
+    //higher locations to a second, per instance binding
+    std::vector<VkVertexInputBindingDescription> vertexBindings;
+    std::vector<VkVertexInputAttributeDescription> vertexAttributes;
+    std::map<std::string, SpecializationConstant> specializationConstants; // stages of every module declaring the name
+};
+
+ShaderReflection reflectSpirv(const uint32_t* code, size_t wordCount);
+PipelineReflection mergeReflections(const std::vector<ShaderReflection>& stages);
+void splitInstanceInputs(PipelineReflection& reflection, uint32_t firstLocation);
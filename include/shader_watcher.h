@@ -0,0 +1,37 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+//set by cmake, fall back to the source tree layout and glslc on the path
+#ifndef SHADER_SOURCE_DIR
+#define SHADER_SOURCE_DIR "../shaders"
+#endif
+#ifndef GLSLC_EXECUTABLE
+#define GLSLC_EXECUTABLE "glslc"
+#endif
+
+// development mode helper, watches the glsl sources with inotify and recompiles edited files to spir-v on its own thread.
+// the render thread picks up the names of rebuilt .spv files with takeChanged and rebuilds what uses them
+class ShaderWatcher {
+private:
+    std::string sourceDir;
+    std::string outputDir;
+    std::string compiler;
+    int inotifyFd = -1;
+    int watchDescriptor = -1;
+    std::thread thread;
+    std::atomic<bool> stopping{false};
+    std::mutex mutex;
+    std::vector<std::string> changed;
+public:
+    ShaderWatcher(const std::string& sourceDir = SHADER_SOURCE_DIR, const std::string& outputDir = "shaders", const std::string& compiler = GLSLC_EXECUTABLE);
+    ~ShaderWatcher();
+    std::vector<std::string> takeChanged();
+private:
+    void watchLoop();
+    bool compile(const std::string& source);
+};
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "buffer.h"
+#include "device.h"
+#include "timeline_semaphore.h"
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <vulkan/vulkan_core.h>
+
+const VkDeviceSize DEFAULT_STAGING_RING_SIZE = 64 * 1024 * 1024;
+
+struct StagingSlice {
+    Buffer* buffer;
+    VkDeviceSize offset;
+    VkDeviceSize size;
+    void* data;
+};
+
+struct StagingStats {
+    uint64_t bytesStaged = 0;
+    uint64_t sliceCount = 0;
+    uint64_t stallCount = 0; // times allocate had to wait for the gpu to free up ring space
+    double stallMilliseconds = 0.0;
+    double bytesPerSecond = 0.0;
+};
+
+// persistently mapped upload buffer handed out in slices, a slice is reused once the timeline reaches the value of the batch it was part of
+class StagingRing {
+private:
+    struct Region {
+        VkDeviceSize bytes;
+        TimelinePoint point;
+    };
+
+    Device* device;
+    VkDeviceSize capacity;
+    Buffer buffer;
+    char* mapped;
+    VkDeviceSize head = 0;
+    VkDeviceSize usedBytes = 0; // everything between the tail and head, including padding and skipped space at the end
+    VkDeviceSize openBytes = 0; // bytes handed out since the last endBatch
+    std::deque<Region> regions;
+    StagingStats stats;
+    std::chrono::high_resolution_clock::time_point createdTime;
+public:
+    StagingRing(Device* device, VkDeviceSize capacity = DEFAULT_STAGING_RING_SIZE);
+    ~StagingRing();
+    StagingSlice allocate(VkDeviceSize size, VkDeviceSize alignment = 16);
+    StagingSlice stage(const void* data, VkDeviceSize size, VkDeviceSize alignment = 16);
+    void endBatch(TimelinePoint point);
+    StagingStats getStats();
+    void printStats();
+    VkDeviceSize getCapacity() { return capacity; }
+private:
+    void retireCompleted();
+    void waitOldest();
+};
@@ -1,36 +1,56 @@
 #pragma once
 
 #include "device.h"
+#include "fence.h"
+#include "global_config.h"
 #include "imageview.h"
+#include "render_target.h"
 #include "surface.h"
 #include "window.h"
+#include <cstdint>
+#include <deque>
+#include <memory>
 #include <semaphore.h>
 #include <vector>
 #include <vulkan/vulkan_core.h>
-class SwapChain {
+class SwapChain : public RenderTarget {
 private:
     Device* device;
     Window* window;
     Surface* surface;
+    RenderConfig config;
     VkSwapchainKHR swapchain;
     std::vector<VkImage> swapChainImages;
-    std::vector<ImageView> imageViews;
+    std::vector<std::unique_ptr<ImageView>> imageViews;
     uint32_t imageIndex;
 
     VkFormat swapchainImageFormat;
     VkExtent2D swapchainImageExtent;
+    VkPresentModeKHR presentMode;
+
+    //swapchain maintenance1 only, one fence per queued present, signalled in present order
+    struct PendingPresent {
+        std::unique_ptr<Fence> fence;
+        uint64_t presentNumber;
+    };
+    std::deque<PendingPresent> pendingPresents;
+    std::vector<std::unique_ptr<Fence>> freeFences;
 public:
-    SwapChain(Device* device, Window* window, Surface* surface);
-    ~SwapChain();
+    SwapChain(Device* device, Window* window, Surface* surface, const RenderConfig& config = RenderConfig{});
+    ~SwapChain() override;
     void recreateSwapchain();
-    bool swap(Semaphore* semaphore = nullptr);
-    bool present(std::vector<Semaphore*> waitSemaphores = {});
-    uint32_t getImageIndex() { return imageIndex; }
-    VkExtent2D getSwapChainExtent() { return swapchainImageExtent; }
-    VkFormat getSwapChainFormat() { return swapchainImageFormat; }
-    size_t getImageCount() { return imageViews.size(); }
-    ImageView* getImageView(size_t index) { return &imageViews[index]; }
+    bool swap(Semaphore* semaphore = nullptr) override;
+    bool present(std::vector<Semaphore*> waitSemaphores = {}) override;
+    uint32_t getImageIndex() override { return imageIndex; }
+    VkExtent2D getExtent() override { return swapchainImageExtent; }
+    VkFormat getFormat() override { return swapchainImageFormat; }
+    size_t getImageCount() override { return imageViews.size(); }
+    VkImage getImage(size_t index) override { return swapChainImages[index]; }
+    ImageView* getImageView(size_t index) override { return imageViews[index].get(); }
+    VkImageLayout getFinalLayout() override { return VK_IMAGE_LAYOUT_PRESENT_SRC_KHR; }
+    VkPresentModeKHR getPresentMode() { return presentMode; }
 private:
     void deleteSwapchain();
-    void initSwapchain();
+    void collectPresentFences();
+    void initSwapchain(VkSwapchainKHR oldSwapchain = VK_NULL_HANDLE);
 };
\ No newline at end of file
@@ -3,6 +3,7 @@
 #include "device.h"
 #include "image.h"
 #include "imageview.h"
+#include "upload_batch.h"
 #include <memory>
 #include <vulkan/vulkan_core.h>
 class Texture {
@@ -11,7 +12,7 @@ private:
     std::unique_ptr<Image> textureImage;
     std::unique_ptr<ImageView> textureImageView;
 public:
-    Texture(Device* device, const char* file);
+    Texture(Device* device, const char* file, UploadBatch* batch = nullptr);
     ~Texture();
     VkImageView getImageView() { return textureImageView->getImageView(); }
 };
\ No newline at end of file
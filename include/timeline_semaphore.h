@@ -0,0 +1,36 @@
+#pragma once
+
+#include "device.h"
+#include <cstdint>
+#include <vulkan/vulkan_core.h>
+
+class TimelineSemaphore;
+
+// a value on a timeline, reached once the gpu work that signals it has finished
+struct TimelinePoint {
+    TimelineSemaphore* timeline = nullptr;
+    uint64_t value = 0;
+
+    bool isReached();
+    void wait();
+};
+
+// vulkan 1.2 timeline semaphore, every submission that signals it reserves the next value in order
+class TimelineSemaphore {
+private:
+    VkSemaphore semaphore;
+    Device* device;
+    uint64_t lastReserved;
+    uint64_t lastCompleted; // cached so polling a value that is already done doesn't call into the driver
+public:
+    TimelineSemaphore(Device* device, uint64_t initialValue = 0);
+    ~TimelineSemaphore();
+    TimelinePoint reserve();
+    uint64_t getCompletedValue();
+    uint64_t getLastReserved() { return lastReserved; }
+    TimelinePoint getLastPoint() { return TimelinePoint{this, lastReserved}; }
+    bool isReached(uint64_t value);
+    bool wait(uint64_t value, uint64_t timeout = UINT64_MAX);
+    void signal(uint64_t value);
+    VkSemaphore getHandle() { return semaphore; }
+};
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "buffer.h"
+#include "device.h"
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <vulkan/vulkan_core.h>
+
+const VkDeviceSize DEFAULT_UNIFORM_FRAME_SIZE = 1024 * 1024;
+
+struct UniformSlice {
+    uint32_t offset; // dynamic offset to bind the frame's descriptor set with
+    void* data;
+};
+
+// bump allocator for uniform data that only lives for one frame. every frame in flight has its own persistently mapped
+// buffer, bound once through a VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC descriptor, and each block is picked with its offset.
+// beginFrame rewinds the frame's buffer, so it has to be called after the frame slot's previous use finished
+class UniformAllocator {
+private:
+    Device* device;
+    std::vector<Buffer> buffers;
+    std::vector<char*> mapped;
+    VkDeviceSize capacity;
+    VkDeviceSize alignment;
+    uint32_t frame = 0;
+    VkDeviceSize head = 0;
+    VkDeviceSize peakBytes = 0;
+    uint64_t allocationCount = 0;
+public:
+    UniformAllocator(Device* device, uint32_t framesInFlight, VkDeviceSize capacity = DEFAULT_UNIFORM_FRAME_SIZE);
+    ~UniformAllocator();
+    void beginFrame(uint32_t frame);
+    UniformSlice allocate(VkDeviceSize size);
+    template<typename T>
+    uint32_t push(const T& value) {
+        UniformSlice slice = allocate(sizeof(T));
+        memcpy(slice.data, &value, sizeof(T));
+        return slice.offset;
+    }
+    VkBuffer getBuffer(uint32_t frame) { return buffers[frame].getHandle(); }
+    VkDeviceSize getCapacity() { return capacity; }
+    VkDeviceSize getUsedBytes() { return head; }
+    void printStats();
+};
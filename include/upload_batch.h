@@ -0,0 +1,64 @@
+#pragma once
+
+#include "buffer.h"
+#include "commandbuffer.h"
+#include "commandpool.h"
+#include "device.h"
+#include "image.h"
+#include "timeline_semaphore.h"
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <vulkan/vulkan_core.h>
+
+// waitable handle for a submitted upload batch, the graphics timeline value its last submission signals
+class UploadToken {
+private:
+    TimelinePoint point;
+public:
+    UploadToken() {}
+    UploadToken(TimelinePoint point) : point(point) {}
+    bool isComplete() { return point.isReached(); }
+    void wait() { point.wait(); }
+    uint64_t getValue() { return point.value; }
+};
+
+// records any number of copies and layout transitions into one command buffer and submits them together.
+// data staged through the batch comes from the device staging ring, only one batch should be staging at a time.
+// with a dedicated transfer queue the copies run there and ownership is handed to the graphics family on submit
+class UploadBatch {
+private:
+    struct PendingImage {
+        Image* image;
+        VkImageLayout finalLayout;
+    };
+
+    Device* device;
+    bool dedicatedTransfer;
+    CommandPool transferPool;
+    CommandBuffer transferCmd;
+    std::unique_ptr<CommandPool> graphicsPool;
+    std::unique_ptr<CommandBuffer> graphicsCmd;
+    std::vector<VkBufferMemoryBarrier> pendingBuffers;
+    std::vector<PendingImage> pendingImages;
+    bool recording = false;
+    uint32_t bufferCopies = 0;
+    uint32_t imageCopies = 0;
+    uint32_t transitions = 0;
+    UploadToken token;
+public:
+    UploadBatch(Device* device);
+    ~UploadBatch();
+    void copyBuffer(Buffer* src, Buffer* dst, VkDeviceSize size, VkDeviceSize srcOffset = 0, VkDeviceSize dstOffset = 0);
+    void uploadBuffer(Buffer* dst, const void* data, VkDeviceSize size, VkDeviceSize dstOffset = 0);
+    void copyBufferToImage(Buffer* src, Image* dst, uint32_t width, uint32_t height, VkDeviceSize srcOffset = 0);
+    void uploadImage(Image* dst, const void* data, VkDeviceSize size, uint32_t width, uint32_t height);
+    void transitionImageLayout(Image* image, VkImageLayout newLayout);
+    UploadToken submit();
+    bool isEmpty() { return !recording; }
+    bool usesTransferQueue() { return dedicatedTransfer; }
+private:
+    void begin();
+    TimelinePoint submitSingleQueue();
+    TimelinePoint submitWithOwnershipTransfer();
+};
@@ -1,12 +1,36 @@
 #version 450
+#extension GL_EXT_nonuniform_qualifier : require
 
-layout(binding = 1) uniform sampler2D texSampler;
+//permutations, picked per pipeline with specialization constants so the driver strips the unused paths
+layout(constant_id = 0) const bool USE_TEXTURE = true;
+layout(constant_id = 1) const bool USE_VERTEX_COLOR = false;
+
+//the device's bindless table, see BindlessTable
+layout(set = 1, binding = 0) uniform texture2D textures[];
+layout(set = 1, binding = 1) uniform sampler samplers[];
+
+//DrawConstants in global_config.h, the layout has to match basic.vert's
+layout(push_constant) uniform DrawConstants {
+    mat4 model;
+    uint textureIndex;
+    uint samplerIndex;
+} draw;
 
 layout(location = 0) in vec3 fragColor;
 layout(location = 1) in vec2 fragTexCoord;
+layout(location = 2) in vec4 fragInstanceColor;
+layout(location = 3) flat in uint fragTextureIndex;
 
 layout(location = 0) out vec4 outColor;
 
 void main() {
-    outColor = texture(texSampler, fragTexCoord);
-}
\ No newline at end of file
+    vec4 color = vec4(1.0);
+    if(USE_TEXTURE) {
+        //instances in one draw can pick different textures
+        color = texture(sampler2D(textures[nonuniformEXT(fragTextureIndex)], samplers[draw.samplerIndex]), fragTexCoord);
+    }
+    if(USE_VERTEX_COLOR) {
+        color.rgb *= fragColor;
+    }
+    outColor = color * fragInstanceColor;
+}
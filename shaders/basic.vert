@@ -1,20 +1,35 @@
 #version 450
 
-layout(binding = 0) uniform UniformBufferObject {
-    mat4 model;
+layout(binding = 0) uniform FrameUniforms {
     mat4 view;
     mat4 proj;
-} ubo;
+} frame;
+
+//DrawConstants in global_config.h, basic.frag declares the same block
+layout(push_constant) uniform DrawConstants {
+    mat4 model;
+    uint textureIndex;
+    uint samplerIndex;
+} draw;
 
 layout(location = 0) in vec2 inPosition;
 layout(location = 1) in vec3 inColor;
 layout(location = 2) in vec2 inTexCoord;
 
+//InstanceData in global_config.h, read once per instance from binding 1
+layout(location = 3) in mat4 instanceTransform;
+layout(location = 7) in vec4 instanceColor;
+layout(location = 8) in uint instanceTexture;
+
 layout(location = 0) out vec3 fragColor;
 layout(location = 1) out vec2 fragTexCoord;
+layout(location = 2) out vec4 fragInstanceColor;
+layout(location = 3) flat out uint fragTextureIndex;
 
 void main() {
-    gl_Position = ubo.proj * ubo.view * ubo.model * vec4(inPosition, 0.0, 1.0);
+    gl_Position = frame.proj * frame.view * draw.model * instanceTransform * vec4(inPosition, 0.0, 1.0);
     fragColor = inColor;
     fragTexCoord = inTexCoord;
+    fragInstanceColor = instanceColor;
+    fragTextureIndex = draw.textureIndex + instanceTexture;
 }
\ No newline at end of file
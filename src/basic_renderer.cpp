@@ -1,23 +1,31 @@
-#include "descriptorpool.h"
+#include "descriptor_cache.h"
 #include "sampler.h"
-#include "swapchain.h"
+#include "render_target.h"
 #include "texture.h"
-#include <array>
+#include "upload_batch.h"
 #include <chrono>
 #include <glm/ext/matrix_clip_space.hpp>
 #include <glm/ext/matrix_transform.hpp>
 #include <glm/ext/vector_float3.hpp>
 #include <glm/trigonometric.hpp>
 #define GLM_FORCE_RADIANS
+#include "bindless_table.h"
 #include "buffer.h"
 #include "global_config.h"
 #include "imageview.h"
 #include "pipeline.h"
+#include "pipeline_compiler.h"
+#include "pipeline_key.h"
+#include "pipeline_layout.h"
+#include <algorithm>
 #include <basic_renderer.h>
 #include <cstddef>
 #include <cstdint>
 #include <cstring>
+#include <exception>
+#include <iostream>
 #include <stdexcept>
+#include <string>
 #include <vector>
 #include <vulkan/vulkan_core.h>
 #include <glm/gtc/matrix_transform.hpp>
@@ -38,10 +46,10 @@ const std::vector<uint16_t> indicies = {
     0, 1, 2, 2, 3, 0
 };
 
-static VkRenderPass createRenderPass(Device* device, SwapChain* swapchain) {
+static VkRenderPass createRenderPass(Device* device, RenderTarget* target) {
     //renderpass attachments, defines all framebuffers that could be attached may need further development in future
     VkAttachmentDescription colorAttachment{};
-    colorAttachment.format = swapchain->getSwapChainFormat();
+    colorAttachment.format = target->getFormat();
     colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
 
     colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
@@ -50,7 +58,7 @@ static VkRenderPass createRenderPass(Device* device, SwapChain* swapchain) {
     colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
 
     colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    colorAttachment.finalLayout = target->getFinalLayout();
 
     VkAttachmentReference colorAttachmentRef{};
     colorAttachmentRef.attachment = 0;
@@ -70,14 +78,28 @@ static VkRenderPass createRenderPass(Device* device, SwapChain* swapchain) {
     dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
     dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
 
+    std::vector<VkSubpassDependency> dependencies = {dependency};
+
+    //offscreen targets copy the image out right after the pass, the copy has to wait for the color writes
+    if(colorAttachment.finalLayout == VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL) {
+        VkSubpassDependency readbackDependency{};
+        readbackDependency.srcSubpass = 0;
+        readbackDependency.dstSubpass = VK_SUBPASS_EXTERNAL;
+        readbackDependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+        readbackDependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+        readbackDependency.dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+        readbackDependency.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        dependencies.push_back(readbackDependency);
+    }
+
     VkRenderPassCreateInfo renderPassInfo{};
     renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
     renderPassInfo.attachmentCount = 1;
     renderPassInfo.pAttachments = &colorAttachment;
     renderPassInfo.subpassCount = 1;
     renderPassInfo.pSubpasses = &subpass;
-    renderPassInfo.dependencyCount = 1;
-    renderPassInfo.pDependencies = &dependency;
+    renderPassInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
+    renderPassInfo.pDependencies = dependencies.data();
 
     VkRenderPass renderPass;
 
@@ -88,173 +110,326 @@ static VkRenderPass createRenderPass(Device* device, SwapChain* swapchain) {
     return renderPass;
 }
 
-BasicRenderer::BasicRenderer(Device* device, SwapChain* swapchain)
-    :device(device), swapchain(swapchain), renderPass(createRenderPass(device, swapchain)), pipeline(device, shaders, swapchain, renderPass),
+BasicRenderer::BasicRenderer(Device* device, RenderTarget* target, const RenderConfig& config)
+    :device(device), target(target), framesInFlight(config.framesInFlight), dynamicRendering(config.dynamicRendering && device->hasDynamicRendering()),
+    renderPass(dynamicRendering ? VK_NULL_HANDLE : createRenderPass(device, target)),
+    pipelineLayout(device, std::vector<std::string>(shaders.begin(), shaders.end()), true, FIRST_INSTANCE_LOCATION),
     pool(device, device->getQueueFamilies().graphicsFamily.value()), 
-    vertexBuffer(device, sizeof(Vertex) * verticies.size(), VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_SHARING_MODE_EXCLUSIVE, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT),
-    indexBuffer(device, sizeof(uint16_t) * indicies.size(), VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_SHARING_MODE_EXCLUSIVE, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT),
-    descriptorPool(device, std::vector<uint32_t>(2, MAX_FRAMES_IN_FLIGHT), std::vector<VkDescriptorType>{VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER}),
-    texture(device, "res/texture/statue.jpg"), sampler(device) {
+    vertexBuffer(device, sizeof(Vertex) * verticies.size(), VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_SHARING_MODE_EXCLUSIVE, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, MEMORY_USAGE_GPU_ONLY),
+    indexBuffer(device, sizeof(uint16_t) * indicies.size(), VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_SHARING_MODE_EXCLUSIVE, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, MEMORY_USAGE_GPU_ONLY),
+    uniforms(device, framesInFlight),
+    uploads(device), texture(device, "res/texture/statue.jpg", &uploads), sampler(device),
+    instances(1, InstanceData{glm::mat4(1.0f), glm::vec4(1.0f), 0}), instanceBuffers(framesInFlight), gpuTimer(device, framesInFlight) {
+
+    //compiles in the background while the rest of the renderer is set up, frames skip the draw until it is done
+    //the vertex layout is reflected from the shader, it has to line up with the Vertex and InstanceData structs the buffers are filled with
+    const std::vector<VkVertexInputBindingDescription>& vertexBindings = pipelineLayout.getVertexBindings();
+    if(vertexBindings.size() != 2 || vertexBindings[0].stride != sizeof(Vertex) || vertexBindings[1].stride != sizeof(InstanceData)) {
+        throw std::runtime_error("VERTEX SHADER INPUTS DO NOT MATCH VERTEX LAYOUT");
+    }
+    const std::vector<VkPushConstantRange>& pushConstantRanges = pipelineLayout.getPushConstantRanges();
+    if(pushConstantRanges.size() != 1 || pushConstantRanges[0].size != sizeof(DrawConstants)) {
+        throw std::runtime_error("SHADER PUSH CONSTANTS DO NOT MATCH DRAW CONSTANTS");
+    }
+    pipelineKey.shaderFiles.assign(shaders.begin(), shaders.end());
+    pipelineKey.specialization = pipelineLayout.resolveSpecialization(config.specialization);
+    pipelineKey.vertexBindings = pipelineLayout.getVertexBindings();
+    pipelineKey.vertexAttributes = pipelineLayout.getVertexAttributes();
+    pipelineKey.renderPass = renderPass;
+    if(dynamicRendering)
+        pipelineKey.colorFormats = {target->getFormat()};
+    pipelineKey.layout = pipelineLayout.getHandle();
+    //whatever the device can set per draw stays out of the pipeline, see PipelineKey::canonical
+    if(config.extendedDynamicState)
+        pipelineKey.dynamicState = getSupportedDynamicState(device);
+    pipeline = device->getPipelineCompiler()->compile(pipelineKey);
     
     createFramebuffers();
 
-    std::vector<VkDescriptorSetLayout> layouts(MAX_FRAMES_IN_FLIGHT, pipeline.getDescriptorSetLayout());
-    VkDescriptorSetAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-    allocInfo.descriptorPool = descriptorPool.getHandle();
-    allocInfo.descriptorSetCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
-    allocInfo.pSetLayouts = layouts.data();
-
-    descriptorSets.resize(MAX_FRAMES_IN_FLIGHT);
-    if(vkAllocateDescriptorSets(device->getDevice(), &allocInfo, descriptorSets.data()) != VK_SUCCESS) {
-        throw std::runtime_error("FAILED TO ALLOCATE DESCRIPTOR SETS");
-    }
-
-    buffers.reserve(MAX_FRAMES_IN_FLIGHT);
-    uniformBuffers.reserve(MAX_FRAMES_IN_FLIGHT);
-    uniformBuffersMapped.reserve(MAX_FRAMES_IN_FLIGHT);
-    for(size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+    buffers.reserve(framesInFlight);
+    for(size_t i = 0; i < framesInFlight; i++) {
         buffers.emplace_back(device, &pool);
-        uniformBuffers.emplace_back(device, sizeof(UniformBufferObject), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_SHARING_MODE_EXCLUSIVE, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-        uniformBuffersMapped.push_back(uniformBuffers[i].mapBuffer());
-
-        VkDescriptorBufferInfo bufferInfo{};
-        bufferInfo.buffer = uniformBuffers[i].getHandle();
-        bufferInfo.offset = 0;
-        bufferInfo.range = sizeof(UniformBufferObject);
-
-        VkDescriptorImageInfo imageInfo{};
-        imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-        imageInfo.imageView = texture.getImageView();
-        imageInfo.sampler = sampler.getHandle();
-
-        std::array<VkWriteDescriptorSet, 2> descriptorWrites{};
-        descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        descriptorWrites[0].dstSet = descriptorSets[i];
-        descriptorWrites[0].dstBinding = 0;
-        descriptorWrites[0].dstArrayElement = 0;
-        descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-        descriptorWrites[0].descriptorCount = 1;
-        descriptorWrites[0].pBufferInfo = &bufferInfo;
-        descriptorWrites[0].pImageInfo = nullptr;
-        descriptorWrites[0].pTexelBufferView = nullptr;
-
-        descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        descriptorWrites[1].dstSet = descriptorSets[i];
-        descriptorWrites[1].dstBinding = 1;
-        descriptorWrites[1].dstArrayElement = 0;
-        descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-        descriptorWrites[1].descriptorCount = 1;
-        descriptorWrites[1].pBufferInfo = nullptr;
-        descriptorWrites[1].pImageInfo = &imageInfo;
-        descriptorWrites[1].pTexelBufferView = nullptr;
-
-        vkUpdateDescriptorSets(device->getDevice(), static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
     }
 
-    {
-        uint64_t size = sizeof(Vertex) * verticies.size();
-        Buffer stagingBuffer(device, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_SHARING_MODE_EXCLUSIVE, 
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-
-        void* data = stagingBuffer.mapBuffer();
-        memcpy(data, verticies.data(), size);
-        stagingBuffer.unmapBuffer();
+    //the indices stay the same for the renderer's lifetime, draws only push them
+    drawConstants.textureIndex = device->getBindlessTable()->registerTexture(&texture);
+    drawConstants.samplerIndex = device->getBindlessTable()->registerSampler(&sampler);
 
-        Buffer::copyBuffer(device, &stagingBuffer, &vertexBuffer, size);
-
-    }
-
-    {
-        uint64_t size = sizeof(uint16_t) * indicies.size();
-        Buffer stagingBuffer(device, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_SHARING_MODE_EXCLUSIVE, 
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-
-        void* data = stagingBuffer.mapBuffer();
-        memcpy(data, indicies.data(), size);
-        stagingBuffer.unmapBuffer();
-
-        Buffer::copyBuffer(device, &stagingBuffer, &indexBuffer, size);
-
-    }
-
-    
+    //texture, vertex and index data all go out in one submission, the barriers in the batch order it before the first draw
+    uploads.uploadBuffer(&vertexBuffer, verticies.data(), sizeof(Vertex) * verticies.size());
+    uploads.uploadBuffer(&indexBuffer, indicies.data(), sizeof(uint16_t) * indicies.size());
+    uploads.submit();
 }
 
 BasicRenderer::~BasicRenderer() {
-    vkDestroyRenderPass(device->getDevice(), renderPass, nullptr);
+    uint64_t issued = 0, skipped = 0;
+    for(auto& buffer : buffers) {
+        issued += buffer.getIssuedStateCount();
+        skipped += buffer.getSkippedStateCount();
+    }
+    std::cout << "Command state: " << issued << " binds/sets recorded, " << skipped << " redundant ones skipped" << std::endl;
+    device->getBindlessTable()->releaseTexture(drawConstants.textureIndex);
+    device->getBindlessTable()->releaseSampler(drawConstants.samplerIndex);
+    //waits for compiles still using the render pass and drops its pipelines from the cache,
+    //the current pipeline may have been replaced in the cache by a shader reload
+    device->getPipelineCompiler()->retire(pipeline);
+    if(renderPass != VK_NULL_HANDLE) {
+        device->getPipelineCompiler()->releaseRenderPass(renderPass);
+        vkDestroyRenderPass(device->getDevice(), renderPass, nullptr);
+    }
 }
 
+//command buffers still in flight may reference the framebuffers, so they go through the device's deferred deletes.
+//dynamic rendering reads the target's image views directly, so there is nothing to rebuild on resize
 void BasicRenderer::destroyFramebuffers() {
+    if(dynamicRendering)
+        return;
+    for(auto& framebuffer : framebuffers) {
+        device->defer(std::move(framebuffer));
+    }
     framebuffers.clear();
 }
 
 void BasicRenderer::createFramebuffers() {
-    framebuffers.reserve(swapchain->getImageCount());
-    for(size_t i = 0; i < swapchain->getImageCount(); i++) {
-        framebuffers.emplace_back(device, renderPass, swapchain->getSwapChainExtent(), std::vector<VkImageView>{ swapchain->getImageView(i)->getImageView() });
+    if(dynamicRendering)
+        return;
+    framebuffers.reserve(target->getImageCount());
+    for(size_t i = 0; i < target->getImageCount(); i++) {
+        framebuffers.emplace_back(new Framebuffer(device, renderPass, target->getExtent(), std::vector<VkImageView>{ target->getImageView(i)->getImageView() }));
+    }
+}
+
+//descriptor sets and vertex buffers were made for the current interface, so only edits that keep it are picked up live
+void BasicRenderer::reloadShaders(const std::vector<std::string>& changed) {
+    bool affected = false;
+    for(const auto& file : changed) {
+        affected |= std::find(pipelineKey.shaderFiles.begin(), pipelineKey.shaderFiles.end(), file) != pipelineKey.shaderFiles.end();
+    }
+    if(!affected)
+        return;
+
+    //the layout cache hands back the same handle when the reflected layout didn't change.
+    //a broken edit is reported and the current pipeline kept, the next save gets another try
+    try {
+        PipelineLayout reloadedLayout(device, pipelineKey.shaderFiles, true, FIRST_INSTANCE_LOCATION);
+        PipelineKey reloadedKey = pipelineKey;
+        reloadedKey.vertexBindings = reloadedLayout.getVertexBindings();
+        reloadedKey.vertexAttributes = reloadedLayout.getVertexAttributes();
+        if(reloadedLayout.getHandle() != pipelineLayout.getHandle() || reloadedKey != pipelineKey) {
+            std::cerr << "Shader interface changed, restart to pick up the new descriptor or vertex layout" << std::endl;
+            return;
+        }
+    } catch(const std::exception& e) {
+        std::cerr << "Shader reload failed, keeping the current pipeline: " << e.what() << std::endl;
+        return;
     }
+
+    pendingPipeline = device->getPipelineCompiler()->recompile(pipelineKey);
+}
+
+//the layout changes the render pass did through its attachment description and dependencies
+static void transitionTargetImage(CommandBuffer* cmdBuffer, VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout,
+        VkAccessFlags srcAccess, VkAccessFlags dstAccess, VkPipelineStageFlags srcStage, VkPipelineStageFlags dstStage) {
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.oldLayout = oldLayout;
+    barrier.newLayout = newLayout;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = image;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.baseMipLevel = 0;
+    barrier.subresourceRange.levelCount = 1;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = 1;
+    barrier.srcAccessMask = srcAccess;
+    barrier.dstAccessMask = dstAccess;
+    vkCmdPipelineBarrier(cmdBuffer->getHandle(), srcStage, dstStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
 }
 
 void BasicRenderer::beginRenderPass(size_t frame) {
-    uint32_t frameIndex = swapchain->getImageIndex();
+    uint32_t frameIndex = target->getImageIndex();
+    VkClearValue clearColor = {{{0.0f, 0.0f, 0.0f, 1.0f}}};
+
+    if(dynamicRendering) {
+        //the previous contents are cleared anyway, so the old layout can be thrown away
+        transitionTargetImage(&buffers[frame], target->getImage(frameIndex), VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+            0, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+
+        VkRenderingAttachmentInfoKHR colorAttachment{};
+        colorAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR;
+        colorAttachment.imageView = target->getImageView(frameIndex)->getImageView();
+        colorAttachment.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+        colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+        colorAttachment.clearValue = clearColor;
+
+        VkRenderingInfoKHR renderingInfo{};
+        renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO_KHR;
+        renderingInfo.renderArea.offset = {0, 0};
+        renderingInfo.renderArea.extent = target->getExtent();
+        renderingInfo.layerCount = 1;
+        renderingInfo.colorAttachmentCount = 1;
+        renderingInfo.pColorAttachments = &colorAttachment;
+        device->getCmdBeginRendering()(buffers[frame].getHandle(), &renderingInfo);
+        return;
+    }
+
     VkRenderPassBeginInfo renderPassInfo{};
     renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
     renderPassInfo.renderPass = renderPass;
-    renderPassInfo.framebuffer = framebuffers[frameIndex].gethandle();
+    renderPassInfo.framebuffer = framebuffers[frameIndex]->gethandle();
     renderPassInfo.renderArea.offset = {0, 0};
-    renderPassInfo.renderArea.extent = swapchain->getSwapChainExtent();
+    renderPassInfo.renderArea.extent = target->getExtent();
 
-    VkClearValue clearColor = {{{0.0f, 0.0f, 0.0f, 1.0f}}};
     renderPassInfo.clearValueCount = 1;
     renderPassInfo.pClearValues = &clearColor;
     vkCmdBeginRenderPass(buffers[frame].getHandle(), &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
 }
 
-void BasicRenderer::updateUniformBuffer(uint32_t currentImage) {
-    static auto startTime = std::chrono::high_resolution_clock::now();
+void BasicRenderer::endRenderPass(size_t frame) {
+    if(!dynamicRendering) {
+        vkCmdEndRenderPass(buffers[frame].getHandle());
+        return;
+    }
 
-    auto currentTime = std::chrono::high_resolution_clock::now();
-    float time = std::chrono::duration<float, std::chrono::seconds::period>(currentTime - startTime).count();
+    device->getCmdEndRendering()(buffers[frame].getHandle());
 
-    UniformBufferObject ubo{};
-    ubo.model = glm::rotate(glm::mat4(1.0f), time * glm::radians(90.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+    //same hand off the render pass's final layout and external dependency gave
+    VkImageLayout finalLayout = target->getFinalLayout();
+    bool readback = finalLayout == VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    transitionTargetImage(&buffers[frame], target->getImage(target->getImageIndex()), VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, finalLayout,
+        VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, readback ? VK_ACCESS_TRANSFER_READ_BIT : 0,
+        VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, readback ? VK_PIPELINE_STAGE_TRANSFER_BIT : VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
+}
 
+//only the camera goes through the uniform buffer, per object data is pushed with each draw.
+//returns the dynamic offset of this frame's block
+uint32_t BasicRenderer::updateUniformBuffer() {
+    FrameUniforms ubo{};
     ubo.view = glm::lookAt(glm::vec3(2.0f, 2.0f, 2.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
 
-    ubo.proj = glm::perspective(glm::radians(45.0f), swapchain->getSwapChainExtent().width / (float) swapchain->getSwapChainExtent().height, 0.1f, 10.0f);
+    ubo.proj = glm::perspective(glm::radians(45.0f), target->getExtent().width / (float) target->getExtent().height, 0.1f, 10.0f);
 
     ubo.proj[1][1] *= -1;
 
-    memcpy(uniformBuffersMapped[currentImage], &ubo, sizeof(ubo));
+    return uniforms.push(ubo);
+}
+
+//throws the compile error when the pipeline failed to build
+void BasicRenderer::waitForPipeline() {
+    pipeline->wait();
+    pipeline->get();
+}
+
+void BasicRenderer::setInstances(const std::vector<InstanceData>& instances) {
+    this->instances = instances;
+}
+
+//host visible and rewritten every frame, the scheduler has waited for the slot so nothing still reads it.
+//a buffer that is too small is replaced, the old one goes through the device's deferred deletes
+void BasicRenderer::updateInstanceBuffer(size_t frame) {
+    VkDeviceSize size = sizeof(InstanceData) * instances.size();
+    if(size == 0)
+        return;
+    if(!instanceBuffers[frame] || instanceBuffers[frame]->getSize() < size) {
+        if(instanceBuffers[frame])
+            device->defer(std::move(instanceBuffers[frame]));
+        instanceBuffers[frame].reset(new Buffer(device, size, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_SHARING_MODE_EXCLUSIVE,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, MEMORY_USAGE_DYNAMIC));
+    }
+    memcpy(instanceBuffers[frame]->mapBuffer(), instances.data(), size);
+}
+
+static glm::mat4 getModelMatrix() {
+    static auto startTime = std::chrono::high_resolution_clock::now();
+
+    auto currentTime = std::chrono::high_resolution_clock::now();
+    float time = std::chrono::duration<float, std::chrono::seconds::period>(currentTime - startTime).count();
+    return glm::rotate(glm::mat4(1.0f), time * glm::radians(90.0f), glm::vec3(0.0f, 0.0f, 1.0f));
 }
 
-void BasicRenderer::render(size_t frame, Fence* fence, std::vector<Semaphore*> signalSemaphores, std::vector<Semaphore*> waitSemaphores, std::vector<VkPipelineStageFlags> waitStages) {
-    updateUniformBuffer(frame);
+//the key follows the reflected bindings, each descriptor type maps to the one resource the renderer has of that kind.
+//the resources don't change between frames, so after the first use of each frame slot this is a cache hit
+VkDescriptorSet BasicRenderer::getDescriptorSet(size_t frame) {
+    DescriptorSetKey key;
+    key.layout = pipelineLayout.getDescriptorSetLayout();
+    for(const auto& binding : pipelineLayout.getBindings()) {
+        if(binding.descriptorType == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC) {
+            key.addBuffer(binding.binding, binding.descriptorType, uniforms.getBuffer(frame), 0, sizeof(FrameUniforms));
+        } else if(binding.descriptorType == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER) {
+            key.addImage(binding.binding, binding.descriptorType, texture.getImageView(), sampler.getHandle());
+        } else {
+            throw std::runtime_error("NO RESOURCE FOR REFLECTED DESCRIPTOR BINDING");
+        }
+    }
+    return device->getDescriptorCache()->get(key);
+}
+
+void BasicRenderer::render(size_t frame, TimelinePoint signal, std::vector<Semaphore*> signalSemaphores, std::vector<Semaphore*> waitSemaphores, std::vector<VkPipelineStageFlags> waitStages) {
+    //swap at the frame boundary, frames already submitted keep the old pipeline until it is retired through the device
+    if(pendingPipeline && pendingPipeline->isReady()) {
+        try {
+            pendingPipeline->get();
+            device->getPipelineCompiler()->retire(pipeline);
+            pipeline = pendingPipeline;
+            std::cout << "Swapped in rebuilt pipeline" << std::endl;
+        } catch(const std::exception& e) {
+            std::cerr << "Pipeline rebuild failed, keeping the previous one: " << e.what() << std::endl;
+        }
+        pendingPipeline.reset();
+    }
+
+    //the scheduler has waited for this frame slot, so its uniform buffer can be rewound
+    uniforms.beginFrame(frame);
+    uint32_t frameOffset = updateUniformBuffer();
+    VkDescriptorSet descriptorSet = getDescriptorSet(frame);
+    updateInstanceBuffer(frame);
     buffers[frame].reset();
     buffers[frame].startRecording();
+    gpuTimer.begin(&buffers[frame], frame);
     beginRenderPass(frame);
-    pipeline.bind(&buffers[frame]);
-    vertexBuffer.bindVertex(&buffers[frame]);
-    indexBuffer.bindIndex(&buffers[frame]);
+
+    //the pass still runs without the pipeline so the target is cleared and the frame's semaphores are signalled
+    Pipeline* readyPipeline = pipeline->get();
+    if(readyPipeline != nullptr && !instances.empty()) {
+        if(skippedDraws > 0) {
+            std::cout << "Pipeline ready after skipping " << skippedDraws << " draws" << std::endl;
+            skippedDraws = 0;
+        }
+
+        readyPipeline->bind(&buffers[frame]);
+        vertexBuffer.bindVertex(&buffers[frame]);
+        instanceBuffers[frame]->bindVertex(&buffers[frame], 1);
+        indexBuffer.bindIndex(&buffers[frame]);
     
-    VkViewport viewport{};
-    viewport.x = 0.0f;
-    viewport.y = 0.0f;
-    viewport.width = swapchain->getSwapChainExtent().width;
-    viewport.height = swapchain->getSwapChainExtent().height;
-    viewport.minDepth = 0.0f;
-    viewport.maxDepth = 1.0f;
-    vkCmdSetViewport(buffers[frame].getHandle(), 0, 1, &viewport);
-
-    VkRect2D scissor{};
-    scissor.offset = {0, 0};
-    scissor.extent = swapchain->getSwapChainExtent();
-    vkCmdSetScissor(buffers[frame].getHandle(), 0, 1, &scissor);
-
-    vkCmdBindDescriptorSets(buffers[frame].getHandle(), VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.getPipelineLayout(), 0, 1, &descriptorSets[frame], 0, nullptr);
-    vkCmdDrawIndexed(buffers[frame].getHandle(), static_cast<uint32_t>(indicies.size()), 1, 0, 0, 0);
-    vkCmdEndRenderPass(buffers[frame].getHandle());
+        VkViewport viewport{};
+        viewport.x = 0.0f;
+        viewport.y = 0.0f;
+        viewport.width = target->getExtent().width;
+        viewport.height = target->getExtent().height;
+        viewport.minDepth = 0.0f;
+        viewport.maxDepth = 1.0f;
+        buffers[frame].setViewport(viewport);
+
+        VkRect2D scissor{};
+        scissor.offset = {0, 0};
+        scissor.extent = target->getExtent();
+        buffers[frame].setScissor(scissor);
+        buffers[frame].applyDynamicState(pipelineKey);
+        const std::vector<VkPushConstantRange>& pushConstantRanges = pipelineLayout.getPushConstantRanges();
+
+        vkCmdBindDescriptorSets(buffers[frame].getHandle(), VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout.getHandle(), 0, 1, &descriptorSet, 1, &frameOffset);
+        device->getBindlessTable()->bind(buffers[frame].getHandle(), pipelineLayout.getHandle());
+        drawConstants.model = getModelMatrix();
+        vkCmdPushConstants(buffers[frame].getHandle(), pipelineLayout.getHandle(), pushConstantRanges[0].stageFlags, 0, sizeof(DrawConstants), &drawConstants);
+        vkCmdDrawIndexed(buffers[frame].getHandle(), static_cast<uint32_t>(indicies.size()), static_cast<uint32_t>(instances.size()), 0, 0, 0);
+    } else if(readyPipeline == nullptr) {
+        skippedDraws++;
+    }
+    endRenderPass(frame);
+    gpuTimer.end(&buffers[frame], frame);
+    target->recordFinish(&buffers[frame], signal);
     buffers[frame].stopRecording();
-    buffers[frame].submit(device->getGraphicsQueue(), fence, signalSemaphores, waitSemaphores, waitStages);
+    buffers[frame].submit(device->getGraphicsQueue(), signal, {}, {}, signalSemaphores, waitSemaphores, waitStages);
 }
\ No newline at end of file
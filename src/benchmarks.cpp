@@ -0,0 +1,167 @@
+#include "basic_renderer.h"
+#include "buffer.h"
+#include "descriptor_allocator.h"
+#include "frame_scheduler.h"
+#include "global_config.h"
+#include "gpu_timer.h"
+#include "image.h"
+#include "imageview.h"
+#include "layout_cache.h"
+#include "offscreen_target.h"
+#include "sampler.h"
+#include <array>
+#include <benchmarks.h>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <glm/ext/matrix_transform.hpp>
+#include <iostream>
+#include <vector>
+#include <vulkan/vulkan_core.h>
+
+static VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+//the same layout as basic.vert's uniform buffer plus a combined image sampler, each set points at its own slice of one buffer
+void runDescriptorUpdateBenchmark(Device* device, uint32_t setCount, uint32_t frameCount) {
+    std::cout << "Descriptor update benchmark: " << setCount << " sets per frame, " << frameCount << " frames" << std::endl;
+
+    std::vector<VkDescriptorSetLayoutBinding> bindings(2);
+    bindings[0].binding = 0;
+    bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    bindings[0].descriptorCount = 1;
+    bindings[0].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    bindings[1].binding = 1;
+    bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    bindings[1].descriptorCount = 1;
+    bindings[1].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+    VkDescriptorSetLayout layout = device->getLayoutCache()->getSetLayout(bindings);
+    const UpdateTemplate& updateTemplate = device->getLayoutCache()->getUpdateTemplate(layout);
+
+    VkDeviceSize sliceSize = alignUp(256, device->getProperties().limits.minUniformBufferOffsetAlignment);
+    Buffer uniforms(device, sliceSize * setCount, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_SHARING_MODE_EXCLUSIVE, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    Image image(device, 4, 4, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    ImageView view(device, image.getHandle(), VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_ASPECT_COLOR_BIT);
+    Sampler sampler(device);
+
+    DescriptorAllocator allocator(device, getPoolRatios(bindings), 1024);
+    std::vector<VkDescriptorSet> sets(setCount);
+    for(auto& set : sets) {
+        set = allocator.allocate(layout);
+    }
+
+    //the way BasicRenderer used to write its sets, every field filled in per set
+    auto start = std::chrono::high_resolution_clock::now();
+    for(uint32_t frame = 0; frame < frameCount; frame++) {
+        for(uint32_t i = 0; i < setCount; i++) {
+            VkDescriptorBufferInfo bufferInfo{};
+            bufferInfo.buffer = uniforms.getHandle();
+            bufferInfo.offset = sliceSize * i;
+            bufferInfo.range = 256;
+
+            VkDescriptorImageInfo imageInfo{};
+            imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+            imageInfo.imageView = view.getImageView();
+            imageInfo.sampler = sampler.getHandle();
+
+            std::array<VkWriteDescriptorSet, 2> descriptorWrites{};
+            descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            descriptorWrites[0].dstSet = sets[i];
+            descriptorWrites[0].dstBinding = 0;
+            descriptorWrites[0].dstArrayElement = 0;
+            descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+            descriptorWrites[0].descriptorCount = 1;
+            descriptorWrites[0].pBufferInfo = &bufferInfo;
+
+            descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            descriptorWrites[1].dstSet = sets[i];
+            descriptorWrites[1].dstBinding = 1;
+            descriptorWrites[1].dstArrayElement = 0;
+            descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+            descriptorWrites[1].descriptorCount = 1;
+            descriptorWrites[1].pImageInfo = &imageInfo;
+
+            vkUpdateDescriptorSets(device->getDevice(), static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+        }
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    double writeMilliseconds = std::chrono::duration<double, std::milli>(end - start).count() / frameCount;
+
+    //packed infos in slot order, one call per set
+    start = std::chrono::high_resolution_clock::now();
+    for(uint32_t frame = 0; frame < frameCount; frame++) {
+        for(uint32_t i = 0; i < setCount; i++) {
+            std::array<DescriptorInfo, 2> infos;
+            infos[0].buffer = VkDescriptorBufferInfo{uniforms.getHandle(), sliceSize * i, 256};
+            infos[1].image = VkDescriptorImageInfo{sampler.getHandle(), view.getImageView(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+            vkUpdateDescriptorSetWithTemplate(device->getDevice(), sets[i], updateTemplate.handle, infos.data());
+        }
+    }
+    end = std::chrono::high_resolution_clock::now();
+    double templateMilliseconds = std::chrono::duration<double, std::milli>(end - start).count() / frameCount;
+
+    std::cout << "vkUpdateDescriptorSets: " << writeMilliseconds << "ms per frame, " << writeMilliseconds * 1e6 / setCount << "ns per set" << std::endl;
+    std::cout << "Update template: " << templateMilliseconds << "ms per frame, " << templateMilliseconds * 1e6 / setCount << "ns per set ("
+        << writeMilliseconds / templateMilliseconds << "x)" << std::endl;
+    allocator.printStats("Benchmark");
+}
+
+//a square grid of small quads over the renderer's unit quad, every instance with its own transform and color.
+//the pipeline is waited for up front and the first frames are left out, so compilation and the first instance buffer allocations don't count
+void runInstancingBenchmark(Device* device, const RenderConfig& config, uint32_t instanceCount, uint32_t frameCount) {
+    std::cout << "Instancing benchmark: " << instanceCount << " instances, " << frameCount << " frames" << std::endl;
+    const uint32_t warmupFrames = 30;
+
+    OffscreenTarget target(device, VkExtent2D{800, 600}, config.framesInFlight);
+    BasicRenderer renderer(device, &target, config);
+    FrameScheduler scheduler(device, config.framesInFlight, target.getImageCount());
+
+    uint32_t side = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(instanceCount))));
+    float cell = 1.0f / side;
+    std::vector<InstanceData> instances(instanceCount);
+    for(uint32_t i = 0; i < instanceCount; i++) {
+        uint32_t x = i % side, y = i / side;
+        glm::vec3 position((x + 0.5f) * cell - 0.5f, (y + 0.5f) * cell - 0.5f, 0.0f);
+        instances[i].transform = glm::scale(glm::translate(glm::mat4(1.0f), position), glm::vec3(cell * 0.8f));
+        instances[i].color = glm::vec4(static_cast<float>(x) / side, static_cast<float>(y) / side, 1.0f - static_cast<float>(x) / side, 1.0f);
+        instances[i].textureIndex = 0;
+    }
+    renderer.setInstances(instances);
+    //frames without the pipeline draw nothing, they must not be measured
+    renderer.waitForPipeline();
+
+    GpuTimer* gpuTimer = renderer.getGpuTimer();
+    double cpuMilliseconds = 0.0;
+    auto start = std::chrono::high_resolution_clock::now();
+    for(uint32_t i = 0; i < warmupFrames + frameCount; i++) {
+        //warmup results still in flight are dropped, every measured frame is read exactly once
+        if(i == warmupFrames) {
+            gpuTimer->resetStats();
+            start = std::chrono::high_resolution_clock::now();
+        }
+        uint32_t frame = scheduler.beginFrame();
+        target.swap();
+        auto renderStart = std::chrono::high_resolution_clock::now();
+        renderer.render(frame, scheduler.reserveFramePoint());
+        auto renderEnd = std::chrono::high_resolution_clock::now();
+        target.present();
+        scheduler.endFrame();
+
+        if(i < warmupFrames)
+            continue;
+        cpuMilliseconds += std::chrono::duration<double, std::milli>(renderEnd - renderStart).count();
+    }
+    target.flushReadbacks();
+    double wallMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    //the last frames in flight haven't been read by a later frame
+    gpuTimer->drain();
+
+    std::cout << "  cpu (record + submit): " << cpuMilliseconds / frameCount << "ms per frame" << std::endl;
+    if(gpuTimer->getResultCount() > 0)
+        std::cout << "  gpu: " << gpuTimer->getTotalMilliseconds() / gpuTimer->getResultCount() << "ms per frame ("
+            << gpuTimer->getResultCount() << " frames timed)" << std::endl;
+    else
+        std::cout << "  gpu: not measured, no timestamp support" << std::endl;
+    std::cout << "  wall: " << wallMilliseconds / frameCount << "ms per frame (" << frameCount * 1000.0 / wallMilliseconds << " fps)" << std::endl;
+}
@@ -0,0 +1,144 @@
+#include "descriptorpool.h"
+#include "sampler.h"
+#include "texture.h"
+#include <bindless_table.h>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+#include <vulkan/vulkan_core.h>
+
+std::vector<VkDescriptorSetLayoutBinding> BindlessTable::getBindings() {
+    std::vector<VkDescriptorSetLayoutBinding> bindings(2);
+    bindings[0].binding = BINDLESS_TEXTURE_BINDING;
+    bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+    bindings[0].descriptorCount = MAX_BINDLESS_TEXTURES;
+    bindings[0].stageFlags = VK_SHADER_STAGE_ALL;
+    bindings[1].binding = BINDLESS_SAMPLER_BINDING;
+    bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
+    bindings[1].descriptorCount = MAX_BINDLESS_SAMPLERS;
+    bindings[1].stageFlags = VK_SHADER_STAGE_ALL;
+    return bindings;
+}
+
+BindlessTable::BindlessTable(Device* device) :
+    device(device) {
+    std::vector<VkDescriptorSetLayoutBinding> bindings = getBindings();
+    //unused slots are never read and slots can be filled while earlier frames are still in flight
+    std::vector<VkDescriptorBindingFlags> bindingFlags(bindings.size(),
+        VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT);
+
+    VkDescriptorSetLayoutBindingFlagsCreateInfo flagsInfo{};
+    flagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+    flagsInfo.bindingCount = static_cast<uint32_t>(bindingFlags.size());
+    flagsInfo.pBindingFlags = bindingFlags.data();
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.pNext = &flagsInfo;
+    layoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+    layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+    layoutInfo.pBindings = bindings.data();
+
+    if(vkCreateDescriptorSetLayout(device->getDevice(), &layoutInfo, nullptr, &setLayout) != VK_SUCCESS) {
+        throw std::runtime_error("FAILED TO CREATE BINDLESS DESCRIPTOR SET LAYOUT");
+    }
+
+    std::vector<VkDescriptorPoolSize> poolSizes = {
+        {VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, MAX_BINDLESS_TEXTURES},
+        {VK_DESCRIPTOR_TYPE_SAMPLER, MAX_BINDLESS_SAMPLERS}
+    };
+    pool = std::unique_ptr<DescriptorPool>(new DescriptorPool(device, poolSizes, 1, VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT));
+    if(pool->allocate(setLayout, &set) != VK_SUCCESS) {
+        throw std::runtime_error("FAILED TO ALLOCATE BINDLESS DESCRIPTOR SET");
+    }
+}
+
+BindlessTable::~BindlessTable() {
+    std::cout << "Bindless table: " << liveTextures << " textures and " << liveSamplers << " samplers still registered, "
+        << textureCount << " texture slots used" << std::endl;
+    pool.reset();
+    vkDestroyDescriptorSetLayout(device->getDevice(), setLayout, nullptr);
+}
+
+void BindlessTable::write(uint32_t binding, uint32_t index, VkDescriptorType type, const VkDescriptorImageInfo& imageInfo) {
+    VkWriteDescriptorSet write{};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = set;
+    write.dstBinding = binding;
+    write.dstArrayElement = index;
+    write.descriptorType = type;
+    write.descriptorCount = 1;
+    write.pImageInfo = &imageInfo;
+    vkUpdateDescriptorSets(device->getDevice(), 1, &write, 0, nullptr);
+}
+
+uint32_t BindlessTable::registerTexture(Texture* texture) {
+    return registerImage(texture->getImageView());
+}
+
+uint32_t BindlessTable::registerImage(VkImageView view) {
+    std::lock_guard<std::mutex> lock(mutex);
+    uint32_t index;
+    if(!freeTextures.empty()) {
+        index = freeTextures.back();
+        freeTextures.pop_back();
+    } else {
+        if(textureCount == MAX_BINDLESS_TEXTURES) {
+            throw std::runtime_error("BINDLESS TEXTURE TABLE FULL");
+        }
+        index = textureCount++;
+    }
+
+    VkDescriptorImageInfo imageInfo{};
+    imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    imageInfo.imageView = view;
+    write(BINDLESS_TEXTURE_BINDING, index, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, imageInfo);
+    liveTextures++;
+    return index;
+}
+
+uint32_t BindlessTable::registerSampler(Sampler* sampler) {
+    std::lock_guard<std::mutex> lock(mutex);
+    uint32_t index;
+    if(!freeSamplers.empty()) {
+        index = freeSamplers.back();
+        freeSamplers.pop_back();
+    } else {
+        if(samplerCount == MAX_BINDLESS_SAMPLERS) {
+            throw std::runtime_error("BINDLESS SAMPLER TABLE FULL");
+        }
+        index = samplerCount++;
+    }
+
+    VkDescriptorImageInfo imageInfo{};
+    imageInfo.sampler = sampler->getHandle();
+    write(BINDLESS_SAMPLER_BINDING, index, VK_DESCRIPTOR_TYPE_SAMPLER, imageInfo);
+    liveSamplers++;
+    return index;
+}
+
+//frames already submitted may still read the slot, so it only goes back on the free list once they are done
+void BindlessTable::releaseTexture(uint32_t index) {
+    std::lock_guard<std::mutex> lock(mutex);
+    liveTextures--;
+    device->deferDestroy([this, index]() {
+        std::lock_guard<std::mutex> lock(mutex);
+        freeTextures.push_back(index);
+    });
+}
+
+void BindlessTable::releaseSampler(uint32_t index) {
+    std::lock_guard<std::mutex> lock(mutex);
+    liveSamplers--;
+    device->deferDestroy([this, index]() {
+        std::lock_guard<std::mutex> lock(mutex);
+        freeSamplers.push_back(index);
+    });
+}
+
+void BindlessTable::bind(VkCommandBuffer buffer, VkPipelineLayout layout, VkPipelineBindPoint bindPoint) {
+    vkCmdBindDescriptorSets(buffer, bindPoint, layout, BINDLESS_SET, 1, &set, 0, nullptr);
+}
@@ -1,25 +1,19 @@
-#include "commandbuffer.h"
-#include "commandpool.h"
-#include "memory_util.h"
+#include "descriptor_cache.h"
+#include "memory_allocator.h"
+#include "upload_batch.h"
 #include <buffer.h>
+#include <cstdint>
 #include <stdexcept>
 #include <vulkan/vulkan_core.h>
 
-void Buffer::copyBuffer(Device* device, Buffer* src, Buffer* dst, VkDeviceSize size) {
-    CommandPool pool(device, device->getQueueFamilies().graphicsFamily.value());
-    CommandBuffer cmdBuffer(device, &pool);
-    cmdBuffer.startRecording();
-    VkBufferCopy copyRegion{};
-    copyRegion.srcOffset = 0;
-    copyRegion.dstOffset = 0;
-    copyRegion.size = size;
-    vkCmdCopyBuffer(cmdBuffer.getHandle(), src->getHandle(), dst->getHandle(), 1, &copyRegion);
-    cmdBuffer.stopRecording();
-    cmdBuffer.submit(device->getGraphicsQueue());
-    vkQueueWaitIdle(device->getGraphicsQueue());
+//one off copy that blocks until it is done, use an UploadBatch to copy many buffers at once
+void Buffer::copyBuffer(Device* device, Buffer* src, Buffer* dst, VkDeviceSize size, VkDeviceSize srcOffset, VkDeviceSize dstOffset) {
+    UploadBatch batch(device);
+    batch.copyBuffer(src, dst, size, srcOffset, dstOffset);
+    batch.submit().wait();
 }
 
-Buffer::Buffer(Device* device, uint64_t size, VkBufferUsageFlags usage, VkSharingMode sharingMode, VkMemoryPropertyFlags memoryProperties) :
+Buffer::Buffer(Device* device, uint64_t size, VkBufferUsageFlags usage, VkSharingMode sharingMode, VkMemoryPropertyFlags memoryProperties, MemoryUsage memoryUsage) :
     device(device), size(size) {
     VkBufferCreateInfo createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
@@ -34,37 +28,45 @@ Buffer::Buffer(Device* device, uint64_t size, VkBufferUsageFlags usage, VkSharin
     VkMemoryRequirements memRequirements;
     vkGetBufferMemoryRequirements(device->getDevice(), buffer, &memRequirements);
 
-    VkMemoryAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memRequirements.size;
-    allocInfo.memoryTypeIndex = findMemoryType(device, memRequirements.memoryTypeBits, memoryProperties);
+    allocation = device->getAllocator()->allocate(memRequirements, memoryProperties, memoryUsage);
 
-    if(vkAllocateMemory(device->getDevice(), &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS) {
-        throw std::runtime_error("FAILED TO ALLOCATE BUFFER MEMORY");
+    if(vkBindBufferMemory(device->getDevice(), buffer, allocation.memory, allocation.offset) != VK_SUCCESS) {
+        throw std::runtime_error("FAILED TO BIND BUFFER MEMORY");
     }
 
-    vkBindBufferMemory(device->getDevice(), buffer, bufferMemory, 0);
-
 }
 
 Buffer::~Buffer() {
+    //cached descriptor sets pointing at this can't be handed out again
+    if(device->getDescriptorCache() != nullptr)
+        device->getDescriptorCache()->evict(reinterpret_cast<uint64_t>(buffer));
     vkDestroyBuffer(device->getDevice(), buffer, nullptr);
-    vkFreeMemory(device->getDevice(), bufferMemory, nullptr);
+    device->getAllocator()->free(allocation);
 }
 
 void* Buffer::mapBuffer() {
-    void* data;
-    vkMapMemory(device->getDevice(), bufferMemory, 0, size, 0, &data);
-    return data;
+    //host visible memory blocks are mapped once by the allocator, so this is just a pointer into the block
+    if(allocation.mapped == nullptr) {
+        throw std::runtime_error("BUFFER MEMORY IS NOT HOST VISIBLE");
+    }
+    return allocation.mapped;
 }
 
 void Buffer::unmapBuffer() {
-    vkUnmapMemory(device->getDevice(), bufferMemory);
+    //nothing to do, the memory block stays mapped until the allocator frees it
+}
+
+void Buffer::flush() {
+    device->getAllocator()->flush(allocation);
+}
+
+void Buffer::invalidate() {
+    device->getAllocator()->invalidate(allocation);
 }
 
-void Buffer::bindVertex(CommandBuffer* cmdBuffer) {
+void Buffer::bindVertex(CommandBuffer* cmdBuffer, uint32_t binding) {
     VkDeviceSize offsets[] = {0};
-    vkCmdBindVertexBuffers(cmdBuffer->getHandle(), 0, 1, &buffer, offsets);
+    vkCmdBindVertexBuffers(cmdBuffer->getHandle(), binding, 1, &buffer, offsets);
 }
 
 void Buffer::bindIndex(CommandBuffer* cmdBuffer) {
@@ -1,6 +1,9 @@
 #include "fence.h"
+#include "pipeline_key.h"
+#include "timeline_semaphore.h"
 #include <commandbuffer.h>
 #include <cstdint>
+#include <cstring>
 #include <semaphore.h>
 #include <stdexcept>
 #include <vector>
@@ -32,6 +35,13 @@ void CommandBuffer::startRecording() {
     if(vkBeginCommandBuffer(buffer, &beginInfo) != VK_SUCCESS) {
         throw std::runtime_error("FAILED TO BEGIN RECORDING COMMAND BUFFER");
     }
+
+    //nothing carries over between recordings
+    boundPipeline = VK_NULL_HANDLE;
+    boundDynamicState = 0;
+    tracked = 0;
+    viewportTracked = false;
+    scissorTracked = false;
 }
 
 void CommandBuffer::stopRecording() {
@@ -65,8 +75,207 @@ void CommandBuffer::submit(VkQueue queue, Fence* fence, std::vector<Semaphore*>
     submitInfo.signalSemaphoreCount = static_cast<uint32_t>(signalSemaphores.size());
     submitInfo.pSignalSemaphores = signalSemaphoreHandles.data();
 
-    if(vkQueueSubmit(device->getGraphicsQueue(), 1, &submitInfo, fence != nullptr ? fence->getHandle() : VK_NULL_HANDLE) != VK_SUCCESS) {
-        std::runtime_error("FAILED TO SUBMIT COMMAND BUFFER");
+    if(vkQueueSubmit(queue, 1, &submitInfo, fence != nullptr ? fence->getHandle() : VK_NULL_HANDLE) != VK_SUCCESS) {
+        throw std::runtime_error("FAILED TO SUBMIT COMMAND BUFFER");
+    }
+
+}
+
+//binary and timeline semaphores can be mixed in one submit, the values for binary ones are ignored
+void CommandBuffer::submit(VkQueue queue, TimelinePoint signal, std::vector<TimelinePoint> waitPoints, std::vector<VkPipelineStageFlags> waitPointStages,
+        std::vector<Semaphore*> signalSemaphores, std::vector<Semaphore*> waitSemaphores, std::vector<VkPipelineStageFlags> waitStages) {
+    std::vector<VkSemaphore> waitHandles;
+    std::vector<uint64_t> waitValues;
+    std::vector<VkPipelineStageFlags> allWaitStages;
+    for(size_t i = 0; i < waitSemaphores.size(); i++) {
+        waitHandles.push_back(waitSemaphores[i]->getHandle());
+        waitValues.push_back(0);
+        allWaitStages.push_back(waitStages[i]);
+    }
+    for(size_t i = 0; i < waitPoints.size(); i++) {
+        waitHandles.push_back(waitPoints[i].timeline->getHandle());
+        waitValues.push_back(waitPoints[i].value);
+        allWaitStages.push_back(waitPointStages[i]);
+    }
+
+    std::vector<VkSemaphore> signalHandles;
+    std::vector<uint64_t> signalValues;
+    for(auto semaphore : signalSemaphores) {
+        signalHandles.push_back(semaphore->getHandle());
+        signalValues.push_back(0);
+    }
+    signalHandles.push_back(signal.timeline->getHandle());
+    signalValues.push_back(signal.value);
+
+    VkTimelineSemaphoreSubmitInfo timelineInfo{};
+    timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timelineInfo.waitSemaphoreValueCount = static_cast<uint32_t>(waitValues.size());
+    timelineInfo.pWaitSemaphoreValues = waitValues.data();
+    timelineInfo.signalSemaphoreValueCount = static_cast<uint32_t>(signalValues.size());
+    timelineInfo.pSignalSemaphoreValues = signalValues.data();
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.pNext = &timelineInfo;
+    submitInfo.waitSemaphoreCount = static_cast<uint32_t>(waitHandles.size());
+    submitInfo.pWaitSemaphores = waitHandles.data();
+    submitInfo.pWaitDstStageMask = allWaitStages.data();
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &buffer;
+    submitInfo.signalSemaphoreCount = static_cast<uint32_t>(signalHandles.size());
+    submitInfo.pSignalSemaphores = signalHandles.data();
+
+    if(vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+        throw std::runtime_error("FAILED TO SUBMIT COMMAND BUFFER");
+    }
+}
+
+void CommandBuffer::bindPipeline(VkPipelineBindPoint bindPoint, VkPipeline pipeline, uint32_t dynamicState) {
+    if(pipeline == boundPipeline) {
+        skippedStateCount++;
+        return;
+    }
+    vkCmdBindPipeline(buffer, bindPoint, pipeline);
+    issuedStateCount++;
+    boundPipeline = pipeline;
+    boundDynamicState = dynamicState;
+    tracked &= dynamicState;
+}
+
+//counts the call and returns true when it can be skipped, otherwise marks the bit as tracked for the caller to set
+bool CommandBuffer::track(uint32_t bit, bool unchanged) {
+    if((tracked & bit) && unchanged) {
+        skippedStateCount++;
+        return true;
+    }
+    tracked |= bit;
+    issuedStateCount++;
+    return false;
+}
+
+void CommandBuffer::setViewport(const VkViewport& viewport) {
+    if(viewportTracked && memcmp(&this->viewport, &viewport, sizeof(VkViewport)) == 0) {
+        skippedStateCount++;
+        return;
+    }
+    vkCmdSetViewport(buffer, 0, 1, &viewport);
+    issuedStateCount++;
+    this->viewport = viewport;
+    viewportTracked = true;
+}
+
+void CommandBuffer::setScissor(const VkRect2D& scissor) {
+    if(scissorTracked && memcmp(&this->scissor, &scissor, sizeof(VkRect2D)) == 0) {
+        skippedStateCount++;
+        return;
+    }
+    vkCmdSetScissor(buffer, 0, 1, &scissor);
+    issuedStateCount++;
+    this->scissor = scissor;
+    scissorTracked = true;
+}
+
+void CommandBuffer::setCullMode(VkCullModeFlags cullMode) {
+    if(track(DYNAMIC_STATE_CULL_MODE, this->cullMode == cullMode))
+        return;
+    device->getExtendedDynamicState().setCullMode(buffer, cullMode);
+    this->cullMode = cullMode;
+}
+
+void CommandBuffer::setFrontFace(VkFrontFace frontFace) {
+    if(track(DYNAMIC_STATE_FRONT_FACE, this->frontFace == frontFace))
+        return;
+    device->getExtendedDynamicState().setFrontFace(buffer, frontFace);
+    this->frontFace = frontFace;
+}
+
+void CommandBuffer::setPrimitiveTopology(VkPrimitiveTopology topology) {
+    if(track(DYNAMIC_STATE_TOPOLOGY, this->topology == topology))
+        return;
+    device->getExtendedDynamicState().setPrimitiveTopology(buffer, topology);
+    this->topology = topology;
+}
+
+//the three depth states share one bit, they are always set together by applyDynamicState
+void CommandBuffer::setDepthTestEnable(bool depthTest) {
+    if((tracked & DYNAMIC_STATE_DEPTH) && this->depthTest == depthTest) {
+        skippedStateCount++;
+        return;
     }
+    device->getExtendedDynamicState().setDepthTestEnable(buffer, depthTest ? VK_TRUE : VK_FALSE);
+    issuedStateCount++;
+    this->depthTest = depthTest;
+}
 
+void CommandBuffer::setDepthWriteEnable(bool depthWrite) {
+    if((tracked & DYNAMIC_STATE_DEPTH) && this->depthWrite == depthWrite) {
+        skippedStateCount++;
+        return;
+    }
+    device->getExtendedDynamicState().setDepthWriteEnable(buffer, depthWrite ? VK_TRUE : VK_FALSE);
+    issuedStateCount++;
+    this->depthWrite = depthWrite;
+}
+
+void CommandBuffer::setDepthCompareOp(VkCompareOp depthCompareOp) {
+    if((tracked & DYNAMIC_STATE_DEPTH) && this->depthCompareOp == depthCompareOp) {
+        skippedStateCount++;
+        return;
+    }
+    device->getExtendedDynamicState().setDepthCompareOp(buffer, depthCompareOp);
+    issuedStateCount++;
+    this->depthCompareOp = depthCompareOp;
+}
+
+void CommandBuffer::setPrimitiveRestartEnable(bool primitiveRestart) {
+    if(track(DYNAMIC_STATE_PRIMITIVE_RESTART, this->primitiveRestart == primitiveRestart))
+        return;
+    device->getExtendedDynamicState().setPrimitiveRestartEnable(buffer, primitiveRestart ? VK_TRUE : VK_FALSE);
+    this->primitiveRestart = primitiveRestart;
+}
+
+void CommandBuffer::setPolygonMode(VkPolygonMode polygonMode) {
+    if(track(DYNAMIC_STATE_POLYGON_MODE, this->polygonMode == polygonMode))
+        return;
+    device->getExtendedDynamicState().setPolygonMode(buffer, polygonMode);
+    this->polygonMode = polygonMode;
+}
+
+void CommandBuffer::setColorBlendEnable(bool blendEnable) {
+    if(track(DYNAMIC_STATE_BLEND_ENABLE, this->blendEnable == blendEnable))
+        return;
+    VkBool32 enable = blendEnable ? VK_TRUE : VK_FALSE;
+    device->getExtendedDynamicState().setColorBlendEnable(buffer, 0, 1, &enable);
+    this->blendEnable = blendEnable;
+}
+
+void CommandBuffer::setColorWriteMask(VkColorComponentFlags colorWriteMask) {
+    if(track(DYNAMIC_STATE_COLOR_WRITE_MASK, this->colorWriteMask == colorWriteMask))
+        return;
+    device->getExtendedDynamicState().setColorWriteMask(buffer, 0, 1, &colorWriteMask);
+    this->colorWriteMask = colorWriteMask;
+}
+
+void CommandBuffer::applyDynamicState(const PipelineKey& key) {
+    uint32_t dynamicState = key.dynamicState & boundDynamicState;
+    if(dynamicState & DYNAMIC_STATE_CULL_MODE)
+        setCullMode(key.cullMode);
+    if(dynamicState & DYNAMIC_STATE_FRONT_FACE)
+        setFrontFace(key.frontFace);
+    if(dynamicState & DYNAMIC_STATE_TOPOLOGY)
+        setPrimitiveTopology(key.topology);
+    if(dynamicState & DYNAMIC_STATE_DEPTH) {
+        setDepthTestEnable(key.depthTest);
+        setDepthWriteEnable(key.depthWrite);
+        setDepthCompareOp(key.depthCompareOp);
+        tracked |= DYNAMIC_STATE_DEPTH;
+    }
+    if(dynamicState & DYNAMIC_STATE_PRIMITIVE_RESTART)
+        setPrimitiveRestartEnable(key.primitiveRestart);
+    if(dynamicState & DYNAMIC_STATE_POLYGON_MODE)
+        setPolygonMode(key.polygonMode);
+    if(dynamicState & DYNAMIC_STATE_BLEND_ENABLE)
+        setColorBlendEnable(key.blendEnable);
+    if(dynamicState & DYNAMIC_STATE_COLOR_WRITE_MASK)
+        setColorWriteMask(key.colorWriteMask);
 }
@@ -0,0 +1,93 @@
+#include "descriptorpool.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <descriptor_allocator.h>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <vulkan/vulkan_core.h>
+
+DescriptorAllocator::DescriptorAllocator(Device* device, std::vector<DescriptorPoolRatio> ratios, uint32_t setsPerPool) :
+    device(device), ratios(ratios), setsPerPool(setsPerPool) {}
+
+//reset pools are reused before a new one is created, each new pool is half again as big as the last
+std::unique_ptr<DescriptorPool> DescriptorAllocator::takePool() {
+    if(!freePools.empty()) {
+        std::unique_ptr<DescriptorPool> pool = std::move(freePools.back());
+        freePools.pop_back();
+        return pool;
+    }
+
+    std::vector<VkDescriptorPoolSize> poolSizes;
+    for(const auto& ratio : ratios) {
+        VkDescriptorPoolSize poolSize{};
+        poolSize.type = ratio.type;
+        poolSize.descriptorCount = std::max(1u, static_cast<uint32_t>(std::ceil(ratio.ratio * setsPerPool)));
+        poolSizes.push_back(poolSize);
+    }
+    std::unique_ptr<DescriptorPool> pool(new DescriptorPool(device, poolSizes, setsPerPool));
+    setsPerPool = std::min(MAX_SETS_PER_POOL, setsPerPool + setsPerPool / 2);
+    stats.poolCount++;
+    return pool;
+}
+
+VkDescriptorSet DescriptorAllocator::allocate(VkDescriptorSetLayout layout) {
+    if(usedPools.empty())
+        usedPools.push_back(takePool());
+
+    VkDescriptorSet set;
+    VkResult result = usedPools.back()->allocate(layout, &set);
+    if(result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL) {
+        usedPools.push_back(takePool());
+        result = usedPools.back()->allocate(layout, &set);
+    }
+    if(result != VK_SUCCESS) {
+        throw std::runtime_error("FAILED TO ALLOCATE DESCRIPTOR SETS");
+    }
+
+    stats.setsAllocated++;
+    stats.totalSetsAllocated++;
+    stats.peakSetsAllocated = std::max(stats.peakSetsAllocated, stats.setsAllocated);
+    return set;
+}
+
+//every set handed out since the last reset becomes invalid, the caller waits for the gpu to finish with them first
+void DescriptorAllocator::reset() {
+    for(auto& pool : usedPools) {
+        pool->reset();
+        freePools.push_back(std::move(pool));
+    }
+    usedPools.clear();
+    stats.setsAllocated = 0;
+    stats.resetCount++;
+}
+
+DescriptorAllocatorStats DescriptorAllocator::getStats() {
+    DescriptorAllocatorStats current = stats;
+    current.poolsInUse = static_cast<uint32_t>(usedPools.size());
+    return current;
+}
+
+void DescriptorAllocator::printStats(const std::string& name) {
+    DescriptorAllocatorStats current = getStats();
+    std::cout << name << " descriptors: " << current.totalSetsAllocated << " sets over " << current.resetCount << " resets, "
+        << current.setsAllocated << " since the last reset (peak " << current.peakSetsAllocated << "), "
+        << current.poolsInUse << "/" << current.poolCount << " pools in use" << std::endl;
+}
+
+//one set's worth of each descriptor type the bindings use, bindings of the same type are added together
+std::vector<DescriptorPoolRatio> getPoolRatios(const std::vector<VkDescriptorSetLayoutBinding>& bindings) {
+    std::vector<DescriptorPoolRatio> ratios;
+    for(const auto& binding : bindings) {
+        auto it = std::find_if(ratios.begin(), ratios.end(), [&](const DescriptorPoolRatio& ratio) { return ratio.type == binding.descriptorType; });
+        if(it != ratios.end()) {
+            it->ratio += binding.descriptorCount;
+        } else {
+            ratios.push_back({binding.descriptorType, static_cast<float>(binding.descriptorCount)});
+        }
+    }
+    return ratios;
+}
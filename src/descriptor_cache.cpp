@@ -0,0 +1,213 @@
+#include "descriptor_allocator.h"
+#include "device.h"
+#include "layout_cache.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <descriptor_cache.h>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <vector>
+#include <vulkan/vulkan_core.h>
+
+static void hashCombine(size_t& seed, uint64_t value) {
+    seed ^= std::hash<uint64_t>()(value) + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2);
+}
+
+static uint64_t toHandle(const void* handle) {
+    return static_cast<uint64_t>(reinterpret_cast<uintptr_t>(handle));
+}
+
+static bool isBufferType(VkDescriptorType type) {
+    return type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER || type == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER ||
+        type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC || type == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+}
+
+//what one pool holds per set, the cache serves every layout so this is a rough mix rather than reflected counts
+static std::vector<DescriptorPoolRatio> getCacheRatios() {
+    return {
+        {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2.0f},
+        {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1.0f},
+        {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1.0f},
+        {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2.0f},
+        {VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 1.0f},
+        {VK_DESCRIPTOR_TYPE_SAMPLER, 1.0f}
+    };
+}
+
+//bindings are kept sorted so the order they are added in doesn't split the cache
+static DescriptorBinding& insertBinding(std::vector<DescriptorBinding>& bindings, uint32_t binding) {
+    auto it = std::lower_bound(bindings.begin(), bindings.end(), binding, [](const DescriptorBinding& b, uint32_t value) { return b.binding < value; });
+    if(it != bindings.end() && it->binding == binding)
+        return *it;
+    DescriptorBinding added{};
+    added.binding = binding;
+    return *bindings.insert(it, added);
+}
+
+DescriptorSetKey& DescriptorSetKey::addBuffer(uint32_t binding, VkDescriptorType type, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range) {
+    DescriptorBinding& added = insertBinding(bindings, binding);
+    added.type = type;
+    added.buffer = VkDescriptorBufferInfo{buffer, offset, range};
+    return *this;
+}
+
+DescriptorSetKey& DescriptorSetKey::addImage(uint32_t binding, VkDescriptorType type, VkImageView view, VkSampler sampler, VkImageLayout imageLayout) {
+    DescriptorBinding& added = insertBinding(bindings, binding);
+    added.type = type;
+    added.image = VkDescriptorImageInfo{sampler, view, imageLayout};
+    return *this;
+}
+
+size_t DescriptorSetKey::hash() const {
+    size_t seed = 0;
+    hashCombine(seed, toHandle(layout));
+    for(const auto& binding : bindings) {
+        hashCombine(seed, binding.binding);
+        hashCombine(seed, binding.type);
+        if(isBufferType(binding.type)) {
+            hashCombine(seed, toHandle(binding.buffer.buffer));
+            hashCombine(seed, binding.buffer.offset);
+            hashCombine(seed, binding.buffer.range);
+        } else {
+            hashCombine(seed, toHandle(binding.image.imageView));
+            hashCombine(seed, toHandle(binding.image.sampler));
+            hashCombine(seed, binding.image.imageLayout);
+        }
+    }
+    return seed;
+}
+
+bool DescriptorSetKey::operator==(const DescriptorSetKey& other) const {
+    return layout == other.layout && std::equal(bindings.begin(), bindings.end(), other.bindings.begin(), other.bindings.end(),
+        [](const DescriptorBinding& a, const DescriptorBinding& b) {
+            if(a.binding != b.binding || a.type != b.type)
+                return false;
+            if(isBufferType(a.type))
+                return a.buffer.buffer == b.buffer.buffer && a.buffer.offset == b.buffer.offset && a.buffer.range == b.buffer.range;
+            return a.image.imageView == b.image.imageView && a.image.sampler == b.image.sampler && a.image.imageLayout == b.image.imageLayout;
+        });
+}
+
+DescriptorCache::DescriptorCache(Device* device) :
+    device(device), allocator(device, getCacheRatios()) {}
+
+DescriptorCache::~DescriptorCache() {
+    printStats();
+}
+
+//one templated update when the key fills every binding of a layout the layout cache made, plain writes otherwise
+void DescriptorCache::write(VkDescriptorSet set, const DescriptorSetKey& key) {
+    const UpdateTemplate& updateTemplate = device->getLayoutCache()->getUpdateTemplate(key.layout);
+    bool templated = updateTemplate.handle != VK_NULL_HANDLE && updateTemplate.bindings.size() == key.bindings.size() &&
+        std::equal(key.bindings.begin(), key.bindings.end(), updateTemplate.bindings.begin(),
+            [](const DescriptorBinding& binding, uint32_t number) { return binding.binding == number; });
+    if(templated) {
+        std::vector<DescriptorInfo> infos(key.bindings.size());
+        for(size_t i = 0; i < key.bindings.size(); i++) {
+            if(isBufferType(key.bindings[i].type)) {
+                infos[i].buffer = key.bindings[i].buffer;
+            } else {
+                infos[i].image = key.bindings[i].image;
+            }
+        }
+        vkUpdateDescriptorSetWithTemplate(device->getDevice(), set, updateTemplate.handle, infos.data());
+        stats.updates++;
+        return;
+    }
+
+    std::vector<VkWriteDescriptorSet> writes;
+    writes.reserve(key.bindings.size());
+    for(const auto& binding : key.bindings) {
+        VkWriteDescriptorSet write{};
+        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write.dstSet = set;
+        write.dstBinding = binding.binding;
+        write.dstArrayElement = 0;
+        write.descriptorType = binding.type;
+        write.descriptorCount = 1;
+        if(isBufferType(binding.type)) {
+            write.pBufferInfo = &binding.buffer;
+        } else {
+            write.pImageInfo = &binding.image;
+        }
+        writes.push_back(write);
+    }
+    vkUpdateDescriptorSets(device->getDevice(), static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+    stats.updates++;
+}
+
+VkDescriptorSet DescriptorCache::get(const DescriptorSetKey& key) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = sets.find(key);
+    if(it != sets.end()) {
+        stats.hits++;
+        return it->second;
+    }
+
+    stats.misses++;
+    VkDescriptorSet set;
+    std::vector<VkDescriptorSet>& reusable = freeSets[key.layout];
+    if(!reusable.empty()) {
+        set = reusable.back();
+        reusable.pop_back();
+        stats.reused++;
+    } else {
+        set = allocator.allocate(key.layout);
+    }
+    write(set, key);
+
+    sets.emplace(key, set);
+    for(const auto& binding : key.bindings) {
+        if(isBufferType(binding.type)) {
+            referenced.insert(toHandle(binding.buffer.buffer));
+        } else {
+            referenced.insert(toHandle(binding.image.imageView));
+            referenced.insert(toHandle(binding.image.sampler));
+        }
+    }
+    return set;
+}
+
+//called from the destructors of Buffer, ImageView and Sampler. frames in flight may still use the evicted sets,
+//so they only become reusable once the device's deferred deletes get to them
+void DescriptorCache::evict(uint64_t handle) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if(handle == 0 || referenced.erase(handle) == 0)
+        return;
+
+    for(auto it = sets.begin(); it != sets.end();) {
+        bool uses = std::any_of(it->first.bindings.begin(), it->first.bindings.end(), [handle](const DescriptorBinding& binding) {
+            if(isBufferType(binding.type))
+                return toHandle(binding.buffer.buffer) == handle;
+            return toHandle(binding.image.imageView) == handle || toHandle(binding.image.sampler) == handle;
+        });
+        if(!uses) {
+            it++;
+            continue;
+        }
+
+        VkDescriptorSetLayout layout = it->first.layout;
+        VkDescriptorSet set = it->second;
+        device->deferDestroy([this, layout, set]() {
+            std::lock_guard<std::mutex> lock(mutex);
+            freeSets[layout].push_back(set);
+        });
+        stats.evictions++;
+        it = sets.erase(it);
+    }
+}
+
+DescriptorCacheStats DescriptorCache::getStats() {
+    std::lock_guard<std::mutex> lock(mutex);
+    DescriptorCacheStats current = stats;
+    current.entries = sets.size();
+    return current;
+}
+
+void DescriptorCache::printStats() {
+    DescriptorCacheStats current = getStats();
+    std::cout << "Descriptor cache: " << current.entries << " sets, " << current.hits << " hits, " << current.misses << " misses ("
+        << current.reused << " reusing evicted sets), " << current.updates << " set updates, " << current.evictions << " evictions" << std::endl;
+}
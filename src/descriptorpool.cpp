@@ -1,32 +1,37 @@
+#include <cstdint>
 #include <descriptorpool.h>
 #include <stdexcept>
 #include <vector>
 #include <vulkan/vulkan_core.h>
 
-DescriptorPool::DescriptorPool(Device* device, std::vector<uint32_t> counts, std::vector<VkDescriptorType> types) :
+DescriptorPool::DescriptorPool(Device* device, const std::vector<VkDescriptorPoolSize>& poolSizes, uint32_t maxSets, VkDescriptorPoolCreateFlags flags) :
         device(device) {
-    std::vector<VkDescriptorPoolSize> poolSizes(types.size());
-    uint32_t maxCount = 0;
-    for(uint32_t i = 0; i < types.size(); i++){
-        VkDescriptorPoolSize poolSize{};
-        poolSize.type = types[i];
-        poolSize.descriptorCount = counts[i];
-        poolSizes[i] = poolSize;
-        if(counts[i] > maxCount)
-            maxCount = counts[i];
-    }
-
     VkDescriptorPoolCreateInfo createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    createInfo.flags = flags;
     createInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
     createInfo.pPoolSizes = poolSizes.data();
-    createInfo.maxSets = maxCount;
+    createInfo.maxSets = maxSets;
 
     if(vkCreateDescriptorPool(device->getDevice(), &createInfo, nullptr, &pool) != VK_SUCCESS) {
-        throw std::runtime_error("FAILEC TO CREATE DESCRIPTOR SET POOL");
+        throw std::runtime_error("FAILED TO CREATE DESCRIPTOR SET POOL");
     }
 }
 
 DescriptorPool::~DescriptorPool() {
     vkDestroyDescriptorPool(device->getDevice(), pool, nullptr);
-}
\ No newline at end of file
+}
+
+VkResult DescriptorPool::allocate(VkDescriptorSetLayout layout, VkDescriptorSet* set) {
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = pool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &layout;
+    return vkAllocateDescriptorSets(device->getDevice(), &allocInfo, set);
+}
+
+//frees every set allocated from the pool at once, the caller makes sure the gpu is done with them
+void DescriptorPool::reset() {
+    vkResetDescriptorPool(device->getDevice(), pool, 0);
+}
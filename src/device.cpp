@@ -1,4 +1,14 @@
+#include "bindless_table.h"
+#include "descriptor_cache.h"
+#include "layout_cache.h"
+#include "memory_allocator.h"
+#include "pipeline_cache.h"
+#include "pipeline_compiler.h"
+#include "shader_library.h"
+#include "staging_ring.h"
 #include "surface.h"
+#include "timeline_semaphore.h"
+#include <algorithm>
 #include <cstdint>
 #include <device.h>
 #include <optional>
@@ -9,6 +19,7 @@
 #include <vulkan/vulkan.h>
 
 #include <iostream>
+#include <memory>
 #include <vulkan/vulkan_core.h>
 #include <debug.h>
 
@@ -47,32 +58,57 @@ QueueFamilyIndices findQueueFamilies(VkPhysicalDevice device, Surface* surface)
 
     int i = 0;
     for (const auto& queueFamily : queueFamilies) {
-        if(queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
+        bool graphics = queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT;
+        bool compute = queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT;
+        bool transfer = queueFamily.queueFlags & VK_QUEUE_TRANSFER_BIT;
+
+        if(graphics && !indices.graphicsFamily.has_value()) {
             indices.graphicsFamily = i;
         }
         VkBool32 presentSupport = false;
         if(surface != nullptr)
             vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface->getSurface(), &presentSupport);
-        if (presentSupport)
+        if (presentSupport && !indices.presentFamily.has_value())
             indices.presentFamily = i;
-        
-        if(indices.isComplete()) {
-            break;
+
+        //prefer a transfer only family (the copy engine), fall back to any non graphics family that can copy
+        if(!graphics && transfer) {
+            bool replaceable = !indices.transferFamily.has_value() || (queueFamilies[indices.transferFamily.value()].queueFlags & VK_QUEUE_COMPUTE_BIT);
+            if(replaceable && (!compute || !indices.transferFamily.has_value()))
+                indices.transferFamily = i;
+        }
+        if(!graphics && compute && !indices.computeFamily.has_value()) {
+            indices.computeFamily = i;
         }
         i++;
     }
 
+    //present from the graphics family when it can, saves an ownership transfer on the swapchain images
+    if(surface != nullptr && indices.graphicsFamily.has_value()) {
+        VkBool32 presentSupport = false;
+        vkGetPhysicalDeviceSurfaceSupportKHR(device, indices.graphicsFamily.value(), surface->getSurface(), &presentSupport);
+        if(presentSupport)
+            indices.presentFamily = indices.graphicsFamily;
+    }
+
     return indices;
 }
 
-bool checkDeviceExtensionSupport(VkPhysicalDevice device) {
+std::vector<const char*> getRequiredDeviceExtensions(Surface* surface) {
+    if(surface == nullptr)
+        return {};
+    return deviceExtensions;
+}
+
+bool checkDeviceExtensionSupport(VkPhysicalDevice device, Surface* surface) {
+    std::vector<const char*> required = getRequiredDeviceExtensions(surface);
     uint32_t extensionCount;
     vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
 
     std::vector<VkExtensionProperties> availableExtensions(extensionCount);
     vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
 
-    std::set<std::string> requiredExtensions(deviceExtensions.begin(), deviceExtensions.end());
+    std::set<std::string> requiredExtensions(required.begin(), required.end());
     for (const auto& extension : availableExtensions) {
         requiredExtensions.erase(extension.extensionName);
     }
@@ -80,16 +116,114 @@ bool checkDeviceExtensionSupport(VkPhysicalDevice device) {
     return requiredExtensions.empty();
 }
 
+//frame and upload synchronization is built on timeline semaphores, so vulkan 1.2 is the minimum
+bool checkTimelineSemaphoreSupport(VkPhysicalDevice device) {
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(device, &properties);
+    if(properties.apiVersion < VK_API_VERSION_1_2)
+        return false;
+
+    VkPhysicalDeviceVulkan12Features features12{};
+    features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    VkPhysicalDeviceFeatures2 features{};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features.pNext = &features12;
+    vkGetPhysicalDeviceFeatures2(device, &features);
+    return features12.timelineSemaphore;
+}
+
+//textures are bound through one bindless table, see BindlessTable. instances pick their texture per draw, so the index
+//can differ within a draw and needs non uniform indexing
+bool checkDescriptorIndexingSupport(VkPhysicalDevice device) {
+    VkPhysicalDeviceVulkan12Features features12{};
+    features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    VkPhysicalDeviceFeatures2 features{};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features.pNext = &features12;
+    vkGetPhysicalDeviceFeatures2(device, &features);
+    return features12.descriptorIndexing && features12.runtimeDescriptorArray && features12.descriptorBindingPartiallyBound &&
+        features12.descriptorBindingSampledImageUpdateAfterBind && features12.descriptorBindingUpdateUnusedWhilePending &&
+        features12.shaderSampledImageArrayNonUniformIndexing;
+}
+
+bool isExtensionSupported(VkPhysicalDevice device, const char* name) {
+    uint32_t extensionCount;
+    vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+    std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+    vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
+    for(const auto& extension : availableExtensions) {
+        if(std::string(extension.extensionName) == name)
+            return true;
+    }
+    return false;
+}
+
+//optional, old swapchains are retired a frame late without it
+bool checkSwapchainMaintenance1Support(VkPhysicalDevice device) {
+    if(!isExtensionSupported(device, VK_EXT_SWAPCHAIN_MAINTENANCE_1_EXTENSION_NAME))
+        return false;
+
+    VkPhysicalDeviceSwapchainMaintenance1FeaturesEXT maintenanceFeatures{};
+    maintenanceFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SWAPCHAIN_MAINTENANCE_1_FEATURES_EXT;
+    VkPhysicalDeviceFeatures2 features{};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features.pNext = &maintenanceFeatures;
+    vkGetPhysicalDeviceFeatures2(device, &features);
+    return maintenanceFeatures.swapchainMaintenance1;
+}
+
+//optional, the renderer falls back to render passes without it
+bool checkDynamicRenderingSupport(VkPhysicalDevice device) {
+    if(!isExtensionSupported(device, VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME))
+        return false;
+
+    VkPhysicalDeviceDynamicRenderingFeaturesKHR dynamicRenderingFeatures{};
+    dynamicRenderingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
+    VkPhysicalDeviceFeatures2 features{};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features.pNext = &dynamicRenderingFeatures;
+    vkGetPhysicalDeviceFeatures2(device, &features);
+    return dynamicRenderingFeatures.dynamicRendering;
+}
+
+//only fills in which groups are there, the function pointers are loaded once the device exists
+ExtendedDynamicState checkExtendedDynamicStateSupport(VkPhysicalDevice device) {
+    ExtendedDynamicState support{};
+    VkPhysicalDeviceExtendedDynamicStateFeaturesEXT features1{};
+    features1.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_FEATURES_EXT;
+    VkPhysicalDeviceExtendedDynamicState2FeaturesEXT features2{};
+    features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_2_FEATURES_EXT;
+    VkPhysicalDeviceExtendedDynamicState3FeaturesEXT features3{};
+    features3.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_3_FEATURES_EXT;
+    features1.pNext = &features2;
+    features2.pNext = &features3;
+    VkPhysicalDeviceFeatures2 features{};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features.pNext = &features1;
+    vkGetPhysicalDeviceFeatures2(device, &features);
+
+    support.state1 = isExtensionSupported(device, VK_EXT_EXTENDED_DYNAMIC_STATE_EXTENSION_NAME) && features1.extendedDynamicState;
+    support.state2 = isExtensionSupported(device, VK_EXT_EXTENDED_DYNAMIC_STATE_2_EXTENSION_NAME) && features2.extendedDynamicState2;
+    bool state3 = isExtensionSupported(device, VK_EXT_EXTENDED_DYNAMIC_STATE_3_EXTENSION_NAME);
+    support.polygonMode = state3 && features3.extendedDynamicState3PolygonMode;
+    support.colorBlendEnable = state3 && features3.extendedDynamicState3ColorBlendEnable;
+    support.colorWriteMask = state3 && features3.extendedDynamicState3ColorWriteMask;
+    return support;
+}
+
 bool isDeviceSuitable(VkPhysicalDevice device, Surface* surface) {
     QueueFamilyIndices indices = findQueueFamilies(device, surface);
-    bool swapchainAdequate = false;
+    bool extensionsSupported = checkDeviceExtensionSupport(device, surface);
+    //without a surface nothing is presented, so there is no swapchain to check
+    bool swapchainAdequate = surface == nullptr;
     VkPhysicalDeviceFeatures supportedFeatures;
     vkGetPhysicalDeviceFeatures(device, &supportedFeatures);
-    if(checkDeviceExtensionSupport(device)) {
+    if(surface != nullptr && extensionsSupported) {
         SwapChainSupportDetails swapChainSupport = querySwapChainSupport(device, surface);
         swapchainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
     }
-    return (indices.isComplete() || (indices.noPresent() && surface == nullptr)) && checkDeviceExtensionSupport(device) && swapchainAdequate && supportedFeatures.samplerAnisotropy;
+    return (indices.isComplete() || (indices.noPresent() && surface == nullptr)) && extensionsSupported && swapchainAdequate && supportedFeatures.samplerAnisotropy &&
+        supportedFeatures.shaderSampledImageArrayDynamicIndexing && checkTimelineSemaphoreSupport(device) && checkDescriptorIndexingSupport(device);
 }
 
 VkPhysicalDevice pickPhysicalDevice(Instance* instance, Surface* surface) {
@@ -123,18 +257,24 @@ Device::Device(Instance* instance,  Surface* surface) :
         throw std::runtime_error("UNABLE TO FIND SUITABLE GPU!");
     }
 
-    VkPhysicalDeviceProperties deviceProperties;
-    vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+    //cached, allocations and samplers query these all the time
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
 
-    std::cout << "Using Device: " << deviceProperties.deviceName << std::endl;
+    std::cout << "Using Device: " << properties.deviceName << std::endl;
 
-    QueueFamilyIndices indices = findQueueFamilies(physicalDevice, surface);
+    queueFamilies = findQueueFamilies(physicalDevice, surface);
+    QueueFamilyIndices& indices = queueFamilies;
 
     std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
-    std::vector<uint32_t> queueFamilies = {indices.graphicsFamily.value()};
+    std::vector<uint32_t> familiesToCreate = {indices.graphicsFamily.value()};
     if(surface != nullptr)
-        queueFamilies.push_back(indices.presentFamily.value());
-    std::set<uint32_t> uniqueQueueFamilies(queueFamilies.begin(), queueFamilies.end());
+        familiesToCreate.push_back(indices.presentFamily.value());
+    if(indices.transferFamily.has_value())
+        familiesToCreate.push_back(indices.transferFamily.value());
+    if(indices.computeFamily.has_value())
+        familiesToCreate.push_back(indices.computeFamily.value());
+    std::set<uint32_t> uniqueQueueFamilies(familiesToCreate.begin(), familiesToCreate.end());
     float queuePriority = 1.0f;
 
     for(uint32_t queueFamily : uniqueQueueFamilies) {
@@ -148,16 +288,80 @@ Device::Device(Instance* instance,  Surface* surface) :
 
     VkPhysicalDeviceFeatures deviceFeatures{};
     deviceFeatures.samplerAnisotropy = VK_TRUE;
+    //the bindless arrays are indexed with push constants, see BindlessTable
+    deviceFeatures.shaderSampledImageArrayDynamicIndexing = VK_TRUE;
+
+    VkPhysicalDeviceVulkan12Features features12{};
+    features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    features12.timelineSemaphore = VK_TRUE;
+    features12.descriptorIndexing = VK_TRUE;
+    features12.runtimeDescriptorArray = VK_TRUE;
+    features12.descriptorBindingPartiallyBound = VK_TRUE;
+    features12.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+    features12.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+    features12.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+
+    std::vector<const char*> extensions = getRequiredDeviceExtensions(surface);
+
+    VkPhysicalDeviceDynamicRenderingFeaturesKHR dynamicRenderingFeatures{};
+    dynamicRenderingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
+    dynamicRenderingFeatures.dynamicRendering = VK_TRUE;
+    dynamicRendering = checkDynamicRenderingSupport(physicalDevice);
+    if(dynamicRendering) {
+        extensions.push_back(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME);
+        dynamicRenderingFeatures.pNext = features12.pNext;
+        features12.pNext = &dynamicRenderingFeatures;
+    }
+
+    VkPhysicalDeviceSwapchainMaintenance1FeaturesEXT maintenanceFeatures{};
+    maintenanceFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SWAPCHAIN_MAINTENANCE_1_FEATURES_EXT;
+    maintenanceFeatures.swapchainMaintenance1 = VK_TRUE;
+    swapchainMaintenance1 = surface != nullptr && instance->hasSurfaceMaintenance1() && checkSwapchainMaintenance1Support(physicalDevice);
+    if(swapchainMaintenance1) {
+        extensions.push_back(VK_EXT_SWAPCHAIN_MAINTENANCE_1_EXTENSION_NAME);
+        maintenanceFeatures.pNext = features12.pNext;
+        features12.pNext = &maintenanceFeatures;
+    }
+
+    //only the supported parts are enabled, the renderer decides whether to use them
+    extendedDynamicState = checkExtendedDynamicStateSupport(physicalDevice);
+    VkPhysicalDeviceExtendedDynamicStateFeaturesEXT dynamicState1Features{};
+    dynamicState1Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_FEATURES_EXT;
+    dynamicState1Features.extendedDynamicState = VK_TRUE;
+    VkPhysicalDeviceExtendedDynamicState2FeaturesEXT dynamicState2Features{};
+    dynamicState2Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_2_FEATURES_EXT;
+    dynamicState2Features.extendedDynamicState2 = VK_TRUE;
+    VkPhysicalDeviceExtendedDynamicState3FeaturesEXT dynamicState3Features{};
+    dynamicState3Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_3_FEATURES_EXT;
+    dynamicState3Features.extendedDynamicState3PolygonMode = extendedDynamicState.polygonMode;
+    dynamicState3Features.extendedDynamicState3ColorBlendEnable = extendedDynamicState.colorBlendEnable;
+    dynamicState3Features.extendedDynamicState3ColorWriteMask = extendedDynamicState.colorWriteMask;
+    if(extendedDynamicState.state1) {
+        extensions.push_back(VK_EXT_EXTENDED_DYNAMIC_STATE_EXTENSION_NAME);
+        dynamicState1Features.pNext = features12.pNext;
+        features12.pNext = &dynamicState1Features;
+    }
+    if(extendedDynamicState.state2) {
+        extensions.push_back(VK_EXT_EXTENDED_DYNAMIC_STATE_2_EXTENSION_NAME);
+        dynamicState2Features.pNext = features12.pNext;
+        features12.pNext = &dynamicState2Features;
+    }
+    if(extendedDynamicState.polygonMode || extendedDynamicState.colorBlendEnable || extendedDynamicState.colorWriteMask) {
+        extensions.push_back(VK_EXT_EXTENDED_DYNAMIC_STATE_3_EXTENSION_NAME);
+        dynamicState3Features.pNext = features12.pNext;
+        features12.pNext = &dynamicState3Features;
+    }
 
     VkDeviceCreateInfo createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    createInfo.pNext = &features12;
     createInfo.pQueueCreateInfos = queueCreateInfos.data();
     createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
 
     createInfo.pEnabledFeatures = &deviceFeatures;
     
-    createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-    createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+    createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
+    createInfo.ppEnabledExtensionNames = extensions.data();
 
     if (enableValidationLayers) {
         createInfo.enabledLayerCount = static_cast<uint32_t>(validationLayers.size());
@@ -172,23 +376,144 @@ Device::Device(Instance* instance,  Surface* surface) :
 
     std::cout << "Logical Device Created" << std::endl;
 
+    //extension commands aren't exported by the loader, they have to be fetched from the device
+    if(dynamicRendering) {
+        cmdBeginRendering = reinterpret_cast<PFN_vkCmdBeginRenderingKHR>(vkGetDeviceProcAddr(device, "vkCmdBeginRenderingKHR"));
+        cmdEndRendering = reinterpret_cast<PFN_vkCmdEndRenderingKHR>(vkGetDeviceProcAddr(device, "vkCmdEndRenderingKHR"));
+        dynamicRendering = cmdBeginRendering != nullptr && cmdEndRendering != nullptr;
+    }
+    std::cout << "Dynamic rendering " << (dynamicRendering ? "supported" : "not supported, using render passes") << std::endl;
+    loadExtendedDynamicState();
+
     vkGetDeviceQueue(device, indices.graphicsFamily.value(), 0, &graphicsQueue);
     if(surface != nullptr)
         vkGetDeviceQueue(device, indices.presentFamily.value(), 0, &presentQueue);
+
+    //without dedicated families the transfer and compute work shares the graphics queue
+    transferQueue = graphicsQueue;
+    computeQueue = graphicsQueue;
+    if(indices.transferFamily.has_value()) {
+        vkGetDeviceQueue(device, indices.transferFamily.value(), 0, &transferQueue);
+        std::cout << "Using dedicated transfer queue family " << indices.transferFamily.value() << std::endl;
+    }
+    if(indices.computeFamily.has_value()) {
+        vkGetDeviceQueue(device, indices.computeFamily.value(), 0, &computeQueue);
+        std::cout << "Using async compute queue family " << indices.computeFamily.value() << std::endl;
+    }
+
+    graphicsTimeline = std::unique_ptr<TimelineSemaphore>(new TimelineSemaphore(this));
+    if(indices.transferFamily.has_value())
+        transferTimeline = std::unique_ptr<TimelineSemaphore>(new TimelineSemaphore(this));
+    if(indices.computeFamily.has_value())
+        computeTimeline = std::unique_ptr<TimelineSemaphore>(new TimelineSemaphore(this));
+
+    allocator = std::unique_ptr<MemoryAllocator>(new MemoryAllocator(this));
+    stagingRing = std::unique_ptr<StagingRing>(new StagingRing(this));
+    layoutCache = std::unique_ptr<LayoutCache>(new LayoutCache(this));
+    bindlessTable = std::unique_ptr<BindlessTable>(new BindlessTable(this));
+    descriptorCache = std::unique_ptr<DescriptorCache>(new DescriptorCache(this));
+    shaderLibrary = std::unique_ptr<ShaderLibrary>(new ShaderLibrary(this));
+    pipelineCache = std::unique_ptr<PipelineCache>(new PipelineCache(this));
+    pipelineCompiler = std::unique_ptr<PipelineCompiler>(new PipelineCompiler(this));
 }
 
 Device::~Device(){
+    vkDeviceWaitIdle(device);
+    for(auto& deferred : deferredDeletes) {
+        deferred.destroy();
+    }
+    deferredDeletes.clear();
+    for(auto& deferred : presentDeletes) {
+        deferred.destroy();
+    }
+    presentDeletes.clear();
+    pipelineCompiler.reset();
+    pipelineCache.reset();
+    shaderLibrary.reset();
+    descriptorCache.reset();
+    bindlessTable.reset();
+    layoutCache.reset();
+    stagingRing.reset();
+    computeTimeline.reset();
+    transferTimeline.reset();
+    graphicsTimeline.reset();
+    allocator.reset();
     vkDestroyDevice(device, nullptr);
 }
 
+//a group whose functions don't all load is treated as unsupported
+void Device::loadExtendedDynamicState() {
+    ExtendedDynamicState& eds = extendedDynamicState;
+    if(eds.state1) {
+        eds.setCullMode = reinterpret_cast<PFN_vkCmdSetCullModeEXT>(vkGetDeviceProcAddr(device, "vkCmdSetCullModeEXT"));
+        eds.setFrontFace = reinterpret_cast<PFN_vkCmdSetFrontFaceEXT>(vkGetDeviceProcAddr(device, "vkCmdSetFrontFaceEXT"));
+        eds.setPrimitiveTopology = reinterpret_cast<PFN_vkCmdSetPrimitiveTopologyEXT>(vkGetDeviceProcAddr(device, "vkCmdSetPrimitiveTopologyEXT"));
+        eds.setDepthTestEnable = reinterpret_cast<PFN_vkCmdSetDepthTestEnableEXT>(vkGetDeviceProcAddr(device, "vkCmdSetDepthTestEnableEXT"));
+        eds.setDepthWriteEnable = reinterpret_cast<PFN_vkCmdSetDepthWriteEnableEXT>(vkGetDeviceProcAddr(device, "vkCmdSetDepthWriteEnableEXT"));
+        eds.setDepthCompareOp = reinterpret_cast<PFN_vkCmdSetDepthCompareOpEXT>(vkGetDeviceProcAddr(device, "vkCmdSetDepthCompareOpEXT"));
+        eds.state1 = eds.setCullMode && eds.setFrontFace && eds.setPrimitiveTopology && eds.setDepthTestEnable && eds.setDepthWriteEnable && eds.setDepthCompareOp;
+    }
+    if(eds.state2) {
+        eds.setPrimitiveRestartEnable = reinterpret_cast<PFN_vkCmdSetPrimitiveRestartEnableEXT>(vkGetDeviceProcAddr(device, "vkCmdSetPrimitiveRestartEnableEXT"));
+        eds.state2 = eds.setPrimitiveRestartEnable != nullptr;
+    }
+    if(eds.polygonMode) {
+        eds.setPolygonMode = reinterpret_cast<PFN_vkCmdSetPolygonModeEXT>(vkGetDeviceProcAddr(device, "vkCmdSetPolygonModeEXT"));
+        eds.polygonMode = eds.setPolygonMode != nullptr;
+    }
+    if(eds.colorBlendEnable) {
+        eds.setColorBlendEnable = reinterpret_cast<PFN_vkCmdSetColorBlendEnableEXT>(vkGetDeviceProcAddr(device, "vkCmdSetColorBlendEnableEXT"));
+        eds.colorBlendEnable = eds.setColorBlendEnable != nullptr;
+    }
+    if(eds.colorWriteMask) {
+        eds.setColorWriteMask = reinterpret_cast<PFN_vkCmdSetColorWriteMaskEXT>(vkGetDeviceProcAddr(device, "vkCmdSetColorWriteMaskEXT"));
+        eds.colorWriteMask = eds.setColorWriteMask != nullptr;
+    }
+    std::cout << "Extended dynamic state: " << (eds.state1 ? "1 " : "") << (eds.state2 ? "2 " : "")
+        << (eds.polygonMode ? "polygon mode " : "") << (eds.colorBlendEnable ? "blend enable " : "") << (eds.colorWriteMask ? "write mask" : "") << std::endl;
+}
+
 SwapChainSupportDetails Device::getSwapChainDetails() {
     return querySwapChainSupport(physicalDevice, surface);
 }
 
 QueueFamilyIndices Device::getQueueFamilies() {
-    return findQueueFamilies(physicalDevice, surface);
+    return queueFamilies;
 }
 
 void Device::waitIdle() {
     vkDeviceWaitIdle(device);
+    collectGarbage();
+}
+
+void Device::deferDestroy(std::function<void()> destroy) {
+    deferredDeletes.push_back(DeferredDelete{graphicsTimeline->getLastReserved(), destroy});
+}
+
+void Device::deferPresentDestroy(std::function<void()> destroy) {
+    presentDeletes.push_back(PresentDelete{presentsQueued, destroy});
+}
+
+void Device::completePresents(uint64_t presentCount) {
+    presentsCompleted = std::max(presentsCompleted, presentCount);
+}
+
+void Device::trackFramePresents(uint64_t graphicsValue) {
+    if(!swapchainMaintenance1)
+        framePresents.push_back(FramePresents{graphicsValue, presentsQueued});
+}
+
+void Device::collectGarbage() {
+    while(!deferredDeletes.empty() && graphicsTimeline->isReached(deferredDeletes.front().graphicsValue)) {
+        deferredDeletes.front().destroy();
+        deferredDeletes.pop_front();
+    }
+    while(!framePresents.empty() && graphicsTimeline->isReached(framePresents.front().graphicsValue)) {
+        completePresents(framePresents.front().presentCount);
+        framePresents.pop_front();
+    }
+    while(!presentDeletes.empty() && presentDeletes.front().presentCount <= presentsCompleted) {
+        presentDeletes.front().destroy();
+        presentDeletes.pop_front();
+    }
 }
\ No newline at end of file
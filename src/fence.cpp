@@ -24,4 +24,8 @@ void Fence::wait() {
 
 void Fence::reset() {
     vkResetFences(device->getDevice(), 1, &fence);
+}
+
+bool Fence::isSignaled() {
+    return vkGetFenceStatus(device->getDevice(), fence) == VK_SUCCESS;
 }
\ No newline at end of file
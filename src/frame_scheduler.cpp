@@ -0,0 +1,44 @@
+#include "semaphore.h"
+#include "timeline_semaphore.h"
+#include <cstdint>
+#include <frame_scheduler.h>
+#include <memory>
+#include <vulkan/vulkan_core.h>
+
+FrameScheduler::FrameScheduler(Device* device, uint32_t framesInFlight, size_t swapchainImageCount) :
+    device(device), framesInFlight(framesInFlight), frameValues(framesInFlight, 0) {
+    for(uint32_t i = 0; i < framesInFlight; i++) {
+        imageAvailableSemaphores.emplace_back(new Semaphore(device));
+    }
+    setSwapchainImageCount(swapchainImageCount);
+}
+
+//blocks until the gpu is done with the last frame that used this slot, then frees anything waiting on earlier values
+uint32_t FrameScheduler::beginFrame() {
+    device->getGraphicsTimeline()->wait(frameValues[currentFrame]);
+    device->collectGarbage();
+    return currentFrame;
+}
+
+TimelinePoint FrameScheduler::reserveFramePoint() {
+    TimelinePoint point = device->getGraphicsTimeline()->reserve();
+    frameValues[currentFrame] = point.value;
+    device->trackFramePresents(point.value);
+    return point;
+}
+
+void FrameScheduler::endFrame() {
+    currentFrame = (currentFrame + 1) % framesInFlight;
+}
+
+//a queued present may still be waiting on an old semaphore, they go once the presents queued so far are done
+void FrameScheduler::setSwapchainImageCount(size_t count) {
+    for(auto& semaphore : renderFinishedSemaphores) {
+        Semaphore* retired = semaphore.release();
+        device->deferPresentDestroy([retired]() { delete retired; });
+    }
+    renderFinishedSemaphores.clear();
+    for(size_t i = 0; i < count; i++) {
+        renderFinishedSemaphores.emplace_back(new Semaphore(device));
+    }
+}
@@ -0,0 +1,90 @@
+#include "commandbuffer.h"
+#include <algorithm>
+#include <cstdint>
+#include <gpu_timer.h>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+#include <vulkan/vulkan_core.h>
+
+GpuTimer::GpuTimer(Device* device, uint32_t frameCount) :
+    device(device), frameCount(frameCount), written(frameCount, false) {
+    const VkPhysicalDeviceLimits& limits = device->getProperties().limits;
+    uint32_t queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(device->getPhysicalDevices(), &queueFamilyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(device->getPhysicalDevices(), &queueFamilyCount, queueFamilies.data());
+    uint32_t validBits = queueFamilies[device->getQueueFamilies().graphicsFamily.value()].timestampValidBits;
+    nanosecondsPerTick = limits.timestampPeriod;
+    validMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+    //without timestamps on the graphics queue the timer stays off and reports 0
+    if(!limits.timestampComputeAndGraphics || validBits == 0) {
+        std::cout << "Timestamp queries not supported, gpu time is not measured" << std::endl;
+        return;
+    }
+
+    VkQueryPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    poolInfo.queryCount = frameCount * 2;
+    if(vkCreateQueryPool(device->getDevice(), &poolInfo, nullptr, &pool) != VK_SUCCESS) {
+        throw std::runtime_error("FAILED TO CREATE TIMESTAMP QUERY POOL");
+    }
+}
+
+//frames still in flight write into the pool
+GpuTimer::~GpuTimer() {
+    if(pool == VK_NULL_HANDLE)
+        return;
+    Device* device = this->device;
+    VkQueryPool pool = this->pool;
+    device->deferDestroy([device, pool]() { vkDestroyQueryPool(device->getDevice(), pool, nullptr); });
+}
+
+void GpuTimer::begin(CommandBuffer* buffer, uint32_t frame) {
+    if(pool == VK_NULL_HANDLE)
+        return;
+
+    //the slot's previous frame has finished by the time it is recorded again
+    readResult(frame, false);
+    vkCmdResetQueryPool(buffer->getHandle(), pool, frame * 2, 2);
+    vkCmdWriteTimestamp(buffer->getHandle(), VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, pool, frame * 2);
+}
+
+void GpuTimer::end(CommandBuffer* buffer, uint32_t frame) {
+    if(pool == VK_NULL_HANDLE)
+        return;
+    vkCmdWriteTimestamp(buffer->getHandle(), VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, pool, frame * 2 + 1);
+    written[frame] = true;
+}
+
+//a result that isn't available is dropped rather than counting the previous one again
+void GpuTimer::readResult(uint32_t frame, bool wait) {
+    if(!written[frame])
+        return;
+    written[frame] = false;
+
+    uint64_t timestamps[2];
+    VkQueryResultFlags flags = VK_QUERY_RESULT_64_BIT | (wait ? VK_QUERY_RESULT_WAIT_BIT : 0);
+    if(vkGetQueryPoolResults(device->getDevice(), pool, frame * 2, 2, sizeof(timestamps), timestamps, sizeof(uint64_t), flags) != VK_SUCCESS)
+        return;
+    uint64_t ticks = ((timestamps[1] & validMask) - (timestamps[0] & validMask)) & validMask;
+    lastMilliseconds = ticks * nanosecondsPerTick / 1e6;
+    totalMilliseconds += lastMilliseconds;
+    resultCount++;
+}
+
+void GpuTimer::drain() {
+    if(pool == VK_NULL_HANDLE)
+        return;
+    for(uint32_t frame = 0; frame < frameCount; frame++) {
+        readResult(frame, true);
+    }
+}
+
+void GpuTimer::resetStats() {
+    std::fill(written.begin(), written.end(), false);
+    lastMilliseconds = 0.0;
+    totalMilliseconds = 0.0;
+    resultCount = 0;
+}
@@ -1,11 +1,11 @@
 #include "commandbuffer.h"
-#include "memory_util.h"
+#include "memory_allocator.h"
 #include <image.h>
 #include <stdexcept>
 #include <vulkan/vulkan_core.h>
 
-Image::Image(Device* device, uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties) :
-    device(device), currentFormat(format), currentLayout(VK_IMAGE_LAYOUT_UNDEFINED), cmdPool(device, device->getQueueFamilies().graphicsFamily.value()) {
+Image::Image(Device* device, uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, MemoryUsage memoryUsage) :
+    device(device), currentFormat(format), currentLayout(VK_IMAGE_LAYOUT_UNDEFINED) {
     
     VkImageCreateInfo createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
@@ -15,42 +15,34 @@ Image::Image(Device* device, uint32_t width, uint32_t height, VkFormat format, V
     createInfo.extent.depth = 1;
     createInfo.mipLevels = 1;
     createInfo.arrayLayers = 1;
-    createInfo.format = VK_FORMAT_R8G8B8A8_SRGB;
-    createInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    createInfo.format = format;
+    createInfo.tiling = tiling;
     createInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    createInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    createInfo.usage = usage;
     createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
     createInfo.samples = VK_SAMPLE_COUNT_1_BIT;
     createInfo.flags = 0;
 
     if(vkCreateImage(device->getDevice(), &createInfo, nullptr, &image) != VK_SUCCESS) {
-        throw std::runtime_error("FAILED TO CREATE TEXTURE IMAGE");
+        throw std::runtime_error("FAILED TO CREATE IMAGE");
     }
 
     VkMemoryRequirements memRequirements;
     vkGetImageMemoryRequirements(device->getDevice(), image, &memRequirements);
 
-    VkMemoryAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memRequirements.size;
-    allocInfo.memoryTypeIndex = findMemoryType(device, memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    allocation = device->getAllocator()->allocate(memRequirements, properties, memoryUsage, createInfo.tiling == VK_IMAGE_TILING_LINEAR);
 
-    if(vkAllocateMemory(device->getDevice(), &allocInfo, nullptr, &imageMemory) != VK_SUCCESS) {
-        throw std::runtime_error("FAILED TO ALLOCATE TEXTURE MEMORY");
+    if(vkBindImageMemory(device->getDevice(), image, allocation.memory, allocation.offset) != VK_SUCCESS) {
+        throw std::runtime_error("FAILED TO BIND IMAGE MEMORY");
     }
-
-    vkBindImageMemory(device->getDevice(), image, imageMemory, 0);
 }
 
 Image::~Image() {
     vkDestroyImage(device->getDevice(), image, nullptr);
-    vkFreeMemory(device->getDevice(), imageMemory, nullptr);
+    device->getAllocator()->free(allocation);
 }
 
-void Image::transitionImageLayout(VkImageLayout newLayout) {
-    CommandBuffer cmdBuffer(device, &cmdPool);
-    cmdBuffer.startRecording();
-
+void Image::transitionImageLayout(CommandBuffer* cmdBuffer, VkImageLayout newLayout) {
     VkImageMemoryBarrier barrier{};
     barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
     barrier.oldLayout = currentLayout;
@@ -88,20 +80,47 @@ void Image::transitionImageLayout(VkImageLayout newLayout) {
         throw std::runtime_error("UNSUPPORTED LAYOUT TRANSITION");
     }
 
-    vkCmdPipelineBarrier(cmdBuffer.getHandle(), sourceStage, destinationStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
-
-    cmdBuffer.stopRecording();
-    cmdBuffer.submit(device->getGraphicsQueue());
-    vkQueueWaitIdle(device->getGraphicsQueue());
+    vkCmdPipelineBarrier(cmdBuffer->getHandle(), sourceStage, destinationStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
     currentLayout = newLayout;
 }
 
-void Image::bufferToImage(Buffer* buffer, uint32_t width, uint32_t height) {
-    CommandBuffer cmdBuffer(device, &cmdPool);
-    cmdBuffer.startRecording();
+static VkImageMemoryBarrier ownershipBarrier(VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t srcFamily, uint32_t dstFamily) {
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.oldLayout = oldLayout;
+    barrier.newLayout = newLayout;
+    barrier.srcQueueFamilyIndex = srcFamily;
+    barrier.dstQueueFamilyIndex = dstFamily;
+    barrier.image = image;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.baseMipLevel = 0;
+    barrier.subresourceRange.levelCount = 1;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = 1;
+    return barrier;
+}
+
+//first half of a queue family ownership transfer, recorded on the queue that wrote the image.
+//the layout change is part of the transfer and has to match the acquire exactly
+void Image::releaseOwnership(CommandBuffer* cmdBuffer, VkImageLayout newLayout, uint32_t srcFamily, uint32_t dstFamily) {
+    VkImageMemoryBarrier barrier = ownershipBarrier(image, currentLayout, newLayout, srcFamily, dstFamily);
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = 0;
+    vkCmdPipelineBarrier(cmdBuffer->getHandle(), VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
 
+//second half, recorded on the queue that will read the image after waiting on a semaphore from the release
+void Image::acquireOwnership(CommandBuffer* cmdBuffer, VkImageLayout newLayout, uint32_t srcFamily, uint32_t dstFamily) {
+    VkImageMemoryBarrier barrier = ownershipBarrier(image, currentLayout, newLayout, srcFamily, dstFamily);
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier(cmdBuffer->getHandle(), VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+    currentLayout = newLayout;
+}
+
+void Image::bufferToImage(CommandBuffer* cmdBuffer, Buffer* buffer, uint32_t width, uint32_t height, VkDeviceSize bufferOffset) {
     VkBufferImageCopy region{};
-    region.bufferOffset = 0;
+    region.bufferOffset = bufferOffset;
     region.bufferRowLength = 0;
     region.bufferImageHeight = 0;
 
@@ -113,9 +132,5 @@ void Image::bufferToImage(Buffer* buffer, uint32_t width, uint32_t height) {
     region.imageOffset = {0, 0, 0};
     region.imageExtent = {width, height, 1};
 
-    vkCmdCopyBufferToImage(cmdBuffer.getHandle(), buffer->getHandle(), image, currentLayout, 1, &region);
-
-    cmdBuffer.stopRecording();
-    cmdBuffer.submit(device->getGraphicsQueue());
-    vkQueueWaitIdle(device->getGraphicsQueue());
+    vkCmdCopyBufferToImage(cmdBuffer->getHandle(), buffer->getHandle(), image, currentLayout, 1, &region);
 }
\ No newline at end of file
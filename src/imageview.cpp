@@ -1,3 +1,5 @@
+#include "descriptor_cache.h"
+#include <cstdint>
 #include <imageview.h>
 #include <iostream>
 #include <stdexcept>
@@ -28,5 +30,8 @@ ImageView::ImageView(Device* device, VkImage image, VkFormat format, VkImageAspe
 }
 
 ImageView::~ImageView() {
+    //cached descriptor sets pointing at this can't be handed out again
+    if(device->getDescriptorCache() != nullptr)
+        device->getDescriptorCache()->evict(reinterpret_cast<uint64_t>(imageview));
     vkDestroyImageView(device->getDevice(), imageview, nullptr);
 }
\ No newline at end of file
@@ -6,12 +6,15 @@
 
 #include <debug.h>
 
-std::vector<const char*> getRequiredExtensions() {
-    uint32_t glfwExtensionCount = 0;
-    const char** glfwExtensions;
-    glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
-
-    std::vector<const char*> extensions(glfwExtensions, glfwExtensions+glfwExtensionCount);
+//headless instances skip the surface extensions, glfw isn't initialized without a window
+std::vector<const char*> getRequiredExtensions(bool headless) {
+    std::vector<const char*> extensions;
+    if(!headless) {
+        uint32_t glfwExtensionCount = 0;
+        const char** glfwExtensions;
+        glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+        extensions.assign(glfwExtensions, glfwExtensions+glfwExtensionCount);
+    }
 
     if(enableValidationLayers) {
         extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
@@ -48,9 +51,9 @@ void populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT& create
     createInfo.pUserData = nullptr;
 }
 
-Instance::Instance(const char* appName, uint32_t appVersion, uint32_t apiVersion) {
+Instance::Instance(const char* appName, uint32_t appVersion, uint32_t apiVersion, bool headless) {
     uint32_t glfwExtensionCount = 0;
-    auto requiredExtensions = getRequiredExtensions();
+    auto requiredExtensions = getRequiredExtensions(headless);
 
     uint32_t extensionCount = 0;
     vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, nullptr);
@@ -73,6 +76,22 @@ Instance::Instance(const char* appName, uint32_t appVersion, uint32_t apiVersion
 
     std::cout << "YES" << std::endl;
 
+    //optional, lets the device use swapchain maintenance1 present fences to retire old swapchains
+    if(!headless) {
+        auto available = [&extensions](const char* name) {
+            for(const auto& extension : extensions) {
+                if(strcmp(extension.extensionName, name) == 0)
+                    return true;
+            }
+            return false;
+        };
+        surfaceMaintenance1 = available(VK_KHR_GET_SURFACE_CAPABILITIES_2_EXTENSION_NAME) && available(VK_EXT_SURFACE_MAINTENANCE_1_EXTENSION_NAME);
+        if(surfaceMaintenance1) {
+            requiredExtensions.push_back(VK_KHR_GET_SURFACE_CAPABILITIES_2_EXTENSION_NAME);
+            requiredExtensions.push_back(VK_EXT_SURFACE_MAINTENANCE_1_EXTENSION_NAME);
+        }
+    }
+
     std::cout << "Validation Layers Requested?..." << (enableValidationLayers ? "YES" : "NO") << std::endl;
 
     if(enableValidationLayers) {
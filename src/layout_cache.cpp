@@ -0,0 +1,158 @@
+#include "device.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <layout_cache.h>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+#include <vulkan/vulkan_core.h>
+
+static void hashCombine(size_t& seed, uint64_t value) {
+    seed ^= std::hash<uint64_t>()(value) + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2);
+}
+
+bool LayoutCache::SetLayoutKey::operator==(const SetLayoutKey& other) const {
+    return std::equal(bindings.begin(), bindings.end(), other.bindings.begin(), other.bindings.end(),
+        [](const VkDescriptorSetLayoutBinding& a, const VkDescriptorSetLayoutBinding& b) {
+            return a.binding == b.binding && a.descriptorType == b.descriptorType &&
+                a.descriptorCount == b.descriptorCount && a.stageFlags == b.stageFlags && a.pImmutableSamplers == b.pImmutableSamplers;
+        });
+}
+
+size_t LayoutCache::SetLayoutKeyHash::operator()(const SetLayoutKey& key) const {
+    size_t seed = 0;
+    for(const auto& binding : key.bindings) {
+        hashCombine(seed, binding.binding);
+        hashCombine(seed, binding.descriptorType);
+        hashCombine(seed, binding.descriptorCount);
+        hashCombine(seed, binding.stageFlags);
+    }
+    return seed;
+}
+
+bool LayoutCache::PipelineLayoutKey::operator==(const PipelineLayoutKey& other) const {
+    return setLayouts == other.setLayouts &&
+        std::equal(pushConstantRanges.begin(), pushConstantRanges.end(), other.pushConstantRanges.begin(), other.pushConstantRanges.end(),
+        [](const VkPushConstantRange& a, const VkPushConstantRange& b) {
+            return a.stageFlags == b.stageFlags && a.offset == b.offset && a.size == b.size;
+        });
+}
+
+size_t LayoutCache::PipelineLayoutKeyHash::operator()(const PipelineLayoutKey& key) const {
+    size_t seed = 0;
+    for(const auto& setLayout : key.setLayouts) {
+        hashCombine(seed, reinterpret_cast<uint64_t>(setLayout));
+    }
+    for(const auto& range : key.pushConstantRanges) {
+        hashCombine(seed, range.stageFlags);
+        hashCombine(seed, range.offset);
+        hashCombine(seed, range.size);
+    }
+    return seed;
+}
+
+LayoutCache::LayoutCache(Device* device) :
+    device(device) {}
+
+LayoutCache::~LayoutCache() {
+    std::cout << "Layout cache: " << setLayouts.size() << " descriptor set layouts, " << pipelineLayouts.size() << " pipeline layouts, "
+        << updateTemplates.size() << " update templates" << std::endl;
+    for(auto& entry : updateTemplates) {
+        if(entry.second.handle != VK_NULL_HANDLE)
+            vkDestroyDescriptorUpdateTemplate(device->getDevice(), entry.second.handle, nullptr);
+    }
+    for(auto& entry : pipelineLayouts) {
+        vkDestroyPipelineLayout(device->getDevice(), entry.second, nullptr);
+    }
+    for(auto& entry : setLayouts) {
+        vkDestroyDescriptorSetLayout(device->getDevice(), entry.second, nullptr);
+    }
+}
+
+//bindings are sorted first so the same bindings listed in a different order still hit
+VkDescriptorSetLayout LayoutCache::getSetLayout(const std::vector<VkDescriptorSetLayoutBinding>& bindings) {
+    SetLayoutKey key{bindings};
+    std::sort(key.bindings.begin(), key.bindings.end(), [](const VkDescriptorSetLayoutBinding& a, const VkDescriptorSetLayoutBinding& b) { return a.binding < b.binding; });
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = setLayouts.find(key);
+    if(it != setLayouts.end())
+        return it->second;
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = static_cast<uint32_t>(key.bindings.size());
+    layoutInfo.pBindings = key.bindings.data();
+
+    VkDescriptorSetLayout setLayout;
+    if(vkCreateDescriptorSetLayout(device->getDevice(), &layoutInfo, nullptr, &setLayout) != VK_SUCCESS) {
+        throw std::runtime_error("FAILED TO CREATE DESCRIPTOR SET LAYOUT");
+    }
+    setLayouts.emplace(key, setLayout);
+    layoutBindings.emplace(setLayout, key.bindings);
+    return setLayout;
+}
+
+//one entry per binding, each reading its descriptors from consecutive DescriptorInfo slots
+const UpdateTemplate& LayoutCache::getUpdateTemplate(VkDescriptorSetLayout setLayout) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = updateTemplates.find(setLayout);
+    if(it != updateTemplates.end())
+        return it->second;
+
+    UpdateTemplate updateTemplate;
+    auto bindings = layoutBindings.find(setLayout);
+    if(bindings == layoutBindings.end() || bindings->second.empty())
+        return updateTemplates.emplace(setLayout, updateTemplate).first->second;
+
+    std::vector<VkDescriptorUpdateTemplateEntry> entries;
+    for(const auto& binding : bindings->second) {
+        VkDescriptorUpdateTemplateEntry entry{};
+        entry.dstBinding = binding.binding;
+        entry.dstArrayElement = 0;
+        entry.descriptorCount = binding.descriptorCount;
+        entry.descriptorType = binding.descriptorType;
+        entry.offset = updateTemplate.bindings.size() * sizeof(DescriptorInfo);
+        entry.stride = sizeof(DescriptorInfo);
+        entries.push_back(entry);
+        updateTemplate.bindings.insert(updateTemplate.bindings.end(), binding.descriptorCount, binding.binding);
+    }
+
+    VkDescriptorUpdateTemplateCreateInfo templateInfo{};
+    templateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO;
+    templateInfo.descriptorUpdateEntryCount = static_cast<uint32_t>(entries.size());
+    templateInfo.pDescriptorUpdateEntries = entries.data();
+    templateInfo.templateType = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET;
+    templateInfo.descriptorSetLayout = setLayout;
+
+    if(vkCreateDescriptorUpdateTemplate(device->getDevice(), &templateInfo, nullptr, &updateTemplate.handle) != VK_SUCCESS) {
+        throw std::runtime_error("FAILED TO CREATE DESCRIPTOR UPDATE TEMPLATE");
+    }
+    return updateTemplates.emplace(setLayout, updateTemplate).first->second;
+}
+
+VkPipelineLayout LayoutCache::getPipelineLayout(const std::vector<VkDescriptorSetLayout>& setLayouts, const std::vector<VkPushConstantRange>& pushConstantRanges) {
+    PipelineLayoutKey key{setLayouts, pushConstantRanges};
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = pipelineLayouts.find(key);
+    if(it != pipelineLayouts.end())
+        return it->second;
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(setLayouts.size());
+    pipelineLayoutInfo.pSetLayouts = setLayouts.data();
+    pipelineLayoutInfo.pushConstantRangeCount = static_cast<uint32_t>(pushConstantRanges.size());
+    pipelineLayoutInfo.pPushConstantRanges = pushConstantRanges.data();
+
+    VkPipelineLayout layout;
+    if(vkCreatePipelineLayout(device->getDevice(), &pipelineLayoutInfo, nullptr, &layout) != VK_SUCCESS) {
+        throw std::runtime_error("FAILED TO CREATE PIPELINE LAYOUT");
+    }
+    pipelineLayouts.emplace(key, layout);
+    return layout;
+}
@@ -1,11 +1,22 @@
 #include "basic_renderer.h"
-#include "fence.h"
+#include "benchmarks.h"
+#include "buffer.h"
+#include "frame_scheduler.h"
 #include "global_config.h"
+#include "image.h"
+#include "offscreen_target.h"
 #include "pipeline.h"
+#include "shader_watcher.h"
+#include "staging_ring.h"
 #include "surface.h"
 #include "swapchain.h"
+#include <chrono>
 #include <exception>
-#include <semaphore.h>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
 #include <vector>
 #include <vulkan/vulkan_core.h>
 #include <instance.h>
@@ -29,35 +40,55 @@ private:
     Device device;
     SwapChain swapchain;
     BasicRenderer renderer;
-    std::vector<Semaphore> imageAvailableSemaphores;
-    std::vector<Semaphore> renderFinishedSemaphores;
-    std::vector<Fence> inFlightFences;
-    uint32_t currentFrame = 0;
+    FrameScheduler scheduler;
+    std::unique_ptr<ShaderWatcher> shaderWatcher;
 
 public:
-    HelloTriangleApplication() :
-        instance("Vulkan Test", VK_MAKE_VERSION(1, 0, 0)),
+    HelloTriangleApplication(const RenderConfig& config) :
+        instance("Vulkan Test", VK_MAKE_VERSION(1, 0, 0), VK_API_VERSION_1_2),
         window(WIDTH, HEIGHT, "Vulkan Test"),
         device(&instance, &surface),
         surface(&instance, &window),
-        swapchain(&device, &window, &surface),
-        renderer(&device, &swapchain) {
-        renderFinishedSemaphores.reserve(swapchain.getImageCount());
-        imageAvailableSemaphores.reserve(MAX_FRAMES_IN_FLIGHT);
-        inFlightFences.reserve(MAX_FRAMES_IN_FLIGHT);
-        for(size_t i = 0; i < swapchain.getImageCount(); i++) {
-            renderFinishedSemaphores.emplace_back(&device);
-        }
-        for(size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-            imageAvailableSemaphores.emplace_back(&device);
-            inFlightFences.emplace_back(&device, true);
-        }
+        swapchain(&device, &window, &surface, config),
+        renderer(&device, &swapchain, config),
+        scheduler(&device, config.framesInFlight, swapchain.getImageCount()) {
+        std::cout << "Rendering with " << config.framesInFlight << " frames in flight and " << swapchain.getImageCount() << " swapchain images" << std::endl;
+        if(config.watchShaders)
+            shaderWatcher = std::unique_ptr<ShaderWatcher>(new ShaderWatcher());
     }
 
     void run() {
         mainLoop();
     }    
 
+    //creates a large number of small buffers and images to check the allocator keeps the device memory count low
+    void runMemoryStress(uint32_t count) {
+        std::cout << "Running memory stress test with " << count << " resources" << std::endl;
+        auto start = std::chrono::high_resolution_clock::now();
+        std::vector<std::unique_ptr<Buffer>> buffers;
+        std::vector<std::unique_ptr<Image>> images;
+        uint32_t seed = 1;
+        for(uint32_t i = 0; i < count; i++) {
+            seed = seed * 1664525u + 1013904223u;
+            if(i % 4 == 0) {
+                uint32_t size = 16u << (seed % 4);
+                images.emplace_back(new Image(&device, size, size, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT));
+            } else {
+                buffers.emplace_back(new Buffer(&device, 256 + seed % (256 * 1024), VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_SHARING_MODE_EXCLUSIVE, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT));
+            }
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        std::cout << "Created " << count << " resources in " << std::chrono::duration<double, std::milli>(end - start).count() << "ms" << std::endl;
+        device.getAllocator()->printStats();
+
+        //free every other buffer to leave holes in the blocks
+        for(size_t i = 0; i < buffers.size(); i += 2) {
+            buffers[i].reset();
+        }
+        std::cout << "After freeing every other buffer:" << std::endl;
+        device.getAllocator()->printStats();
+    }
+
 private:
 
     void mainLoop() {
@@ -66,39 +97,205 @@ private:
             window.pollEvents();
         }
         device.waitIdle();
+        device.getStagingRing()->printStats();
+        device.getAllocator()->printStats();
     }
 
     void drawFrame() {
-        inFlightFences[currentFrame].wait();
-        if(!swapchain.swap(&imageAvailableSemaphores[currentFrame])){
+        uint32_t frame = scheduler.beginFrame();
+        if(shaderWatcher)
+            renderer.reloadShaders(shaderWatcher->takeChanged());
+        if(!swapchain.swap(scheduler.getImageAvailable())){
             resize();
             return;
         }
-        inFlightFences[currentFrame].reset();
         uint32_t imageIndex = swapchain.getImageIndex();
-        renderer.render(currentFrame, &inFlightFences[currentFrame], std::vector<Semaphore*> {&renderFinishedSemaphores[imageIndex]}, 
-            std::vector<Semaphore*> {&imageAvailableSemaphores[currentFrame]}, std::vector<VkPipelineStageFlags> {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT});
-        if(!swapchain.present(std::vector<Semaphore*>{&renderFinishedSemaphores[imageIndex]}) || window.getResizedFlag()) {
+        renderer.render(frame, scheduler.reserveFramePoint(), std::vector<Semaphore*> {scheduler.getRenderFinished(imageIndex)}, 
+            std::vector<Semaphore*> {scheduler.getImageAvailable()}, std::vector<VkPipelineStageFlags> {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT});
+        if(!swapchain.present(std::vector<Semaphore*>{scheduler.getRenderFinished(imageIndex)}) || window.getResizedFlag()) {
             resize();
         }
 
-        currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+        scheduler.endFrame();
     }
 
+    //no wait here, in flight frames finish on the old swapchain and its resources are retired through the device
     void resize() {
-        device.waitIdle();
         renderer.destroyFramebuffers();
         swapchain.recreateSwapchain();
         renderer.createFramebuffers();
+        scheduler.setSwapchainImageCount(swapchain.getImageCount());
         window.resetResizedFlag();
     }
 };
 
-int main() {
-    
+VkPresentModeKHR parsePresentMode(const std::string& name) {
+    if(name == "immediate")
+        return VK_PRESENT_MODE_IMMEDIATE_KHR;
+    if(name == "mailbox")
+        return VK_PRESENT_MODE_MAILBOX_KHR;
+    if(name == "fifo")
+        return VK_PRESENT_MODE_FIFO_KHR;
+    if(name == "fifo_relaxed")
+        return VK_PRESENT_MODE_FIFO_RELAXED_KHR;
+    throw std::runtime_error("UNKNOWN PRESENT MODE " + name + ", EXPECTED immediate, mailbox, fifo OR fifo_relaxed");
+}
+
+//NAME=VALUE, bools can be written as true or false
+void parseSpecialization(const std::string& argument, std::map<std::string, uint32_t>& specialization) {
+    size_t split = argument.find('=');
+    if(split == std::string::npos || split == 0) {
+        throw std::runtime_error("EXPECTED --specialize=NAME=VALUE, GOT " + argument);
+    }
+    std::string value = argument.substr(split + 1);
+    if(value == "true")
+        specialization[argument.substr(0, split)] = 1;
+    else if(value == "false")
+        specialization[argument.substr(0, split)] = 0;
+    else
+        specialization[argument.substr(0, split)] = std::stoul(value);
+}
+
+//same renderer without a window, frames go to offscreen images and are read back while the next ones render
+class HeadlessApplication {
+private:
+    Instance instance;
+    Device device;
+    OffscreenTarget target;
+    BasicRenderer renderer;
+    FrameScheduler scheduler;
+    std::vector<unsigned char> lastFrame;
+
+public:
+    HeadlessApplication(const RenderConfig& config) :
+        instance("Vulkan Test", VK_MAKE_VERSION(1, 0, 0), VK_API_VERSION_1_2, true),
+        device(&instance),
+        target(&device, VkExtent2D{WIDTH, HEIGHT}, config.framesInFlight),
+        renderer(&device, &target, config),
+        scheduler(&device, config.framesInFlight, target.getImageCount()) {
+        std::cout << "Rendering headless at " << WIDTH << "x" << HEIGHT << " with " << config.framesInFlight << " frames in flight" << std::endl;
+    }
+
+    void run(uint32_t frameCount, const std::string& outputPath) {
+        bool keepFrame = !outputPath.empty();
+        target.setReadbackCallback([this, keepFrame](const ReadbackFrame& frame) {
+            if(!keepFrame)
+                return;
+            const unsigned char* data = static_cast<const unsigned char*>(frame.data);
+            lastFrame.assign(data, data + frame.size);
+        });
+
+        auto start = std::chrono::high_resolution_clock::now();
+        for(uint32_t i = 0; i < frameCount; i++) {
+            uint32_t frame = scheduler.beginFrame();
+            target.swap();
+            renderer.render(frame, scheduler.reserveFramePoint());
+            target.present();
+            scheduler.endFrame();
+        }
+        target.flushReadbacks();
+        auto end = std::chrono::high_resolution_clock::now();
+
+        double milliseconds = std::chrono::duration<double, std::milli>(end - start).count();
+        std::cout << "Rendered and read back " << target.getReadbackCount() << " frames in " << milliseconds << "ms ("
+            << frameCount / (milliseconds / 1000.0) << " fps)" << std::endl;
+        device.waitIdle();
+        device.getStagingRing()->printStats();
+        device.getAllocator()->printStats();
+
+        if(keepFrame)
+            writeFrame(outputPath);
+    }
+
+private:
+    //binary ppm, the alpha channel is dropped
+    void writeFrame(const std::string& path) {
+        std::ofstream file(path, std::ios::binary);
+        if(!file) {
+            throw std::runtime_error("FAILED TO OPEN " + path + " FOR WRITING");
+        }
+        file << "P6\n" << WIDTH << " " << HEIGHT << "\n255\n";
+        for(size_t i = 0; i + 3 < lastFrame.size(); i += 4) {
+            file.write(reinterpret_cast<const char*>(&lastFrame[i]), 3);
+        }
+        std::cout << "Wrote last frame to " << path << std::endl;
+    }
+};
+
+int main(int argc, char** argv) {
+    uint32_t memoryStressCount = 0;
+    RenderConfig config;
+    bool headless = false;
+    uint32_t headlessFrames = 120;
+    std::string headlessOutput;
+    uint32_t descriptorBenchmarkSets = 0;
+    uint32_t instancingBenchmarkCount = 0;
+
     try{
-        HelloTriangleApplication app;
-        app.run();
+        for(int i = 1; i < argc; i++) {
+            std::string arg(argv[i]);
+            if(arg.rfind("--memory-stress=", 0) == 0) {
+                memoryStressCount = std::stoul(arg.substr(16));
+            } else if(arg.rfind("--frames-in-flight=", 0) == 0) {
+                config.framesInFlight = std::stoul(arg.substr(19));
+                if(config.framesInFlight < 1 || config.framesInFlight > MAX_FRAMES_IN_FLIGHT) {
+                    throw std::runtime_error("FRAMES IN FLIGHT MUST BE BETWEEN 1 AND " + std::to_string(MAX_FRAMES_IN_FLIGHT));
+                }
+            } else if(arg.rfind("--present-mode=", 0) == 0) {
+                config.presentMode = parsePresentMode(arg.substr(15));
+            } else if(arg.rfind("--swapchain-images=", 0) == 0) {
+                config.swapchainImageCount = std::stoul(arg.substr(19));
+            } else if(arg.rfind("--specialize=", 0) == 0) {
+                parseSpecialization(arg.substr(13), config.specialization);
+            } else if(arg == "--no-dynamic-rendering") {
+                config.dynamicRendering = false;
+            } else if(arg == "--extended-dynamic-state") {
+                config.extendedDynamicState = true;
+            } else if(arg == "--watch-shaders") {
+                config.watchShaders = true;
+            } else if(arg == "--headless") {
+                headless = true;
+            } else if(arg.rfind("--headless-frames=", 0) == 0) {
+                headlessFrames = std::stoul(arg.substr(18));
+            } else if(arg.rfind("--headless-output=", 0) == 0) {
+                headlessOutput = arg.substr(18);
+            } else if(arg == "--benchmark-descriptors") {
+                descriptorBenchmarkSets = 10000;
+            } else if(arg.rfind("--benchmark-descriptors=", 0) == 0) {
+                descriptorBenchmarkSets = std::stoul(arg.substr(24));
+            } else if(arg == "--benchmark-instances") {
+                instancingBenchmarkCount = 100000;
+            } else if(arg.rfind("--benchmark-instances=", 0) == 0) {
+                instancingBenchmarkCount = std::stoul(arg.substr(22));
+            }
+        }
+
+        //benchmarks run on a headless device, no window
+        if(descriptorBenchmarkSets > 0) {
+            Instance instance("Vulkan Test", VK_MAKE_VERSION(1, 0, 0), VK_API_VERSION_1_2, true);
+            Device device(&instance);
+            runDescriptorUpdateBenchmark(&device, descriptorBenchmarkSets);
+            return EXIT_SUCCESS;
+        }
+        if(instancingBenchmarkCount > 0) {
+            Instance instance("Vulkan Test", VK_MAKE_VERSION(1, 0, 0), VK_API_VERSION_1_2, true);
+            Device device(&instance);
+            runInstancingBenchmark(&device, config, instancingBenchmarkCount);
+            return EXIT_SUCCESS;
+        }
+
+        if(headless) {
+            HeadlessApplication app(config);
+            app.run(headlessFrames, headlessOutput);
+            return EXIT_SUCCESS;
+        }
+
+        HelloTriangleApplication app(config);
+        if(memoryStressCount > 0) {
+            app.runMemoryStress(memoryStressCount);
+        } else {
+            app.run();
+        }
     } catch (const std::exception& e) {
         std::cerr << "\033[31m" << e.what() << "\033[0m" << std::endl;
         return EXIT_FAILURE;
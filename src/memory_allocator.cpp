@@ -0,0 +1,280 @@
+#include "device.h"
+#include "memory_util.h"
+#include <algorithm>
+#include <iostream>
+#include <iterator>
+#include <memory_allocator.h>
+#include <stdexcept>
+#include <vulkan/vulkan_core.h>
+
+static VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment) {
+    if(alignment <= 1)
+        return value;
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+MemoryBlock::MemoryBlock(Device* device, uint32_t memoryType, VkDeviceSize size, bool hostVisible, bool dedicated) :
+    device(device), size(size), memoryType(memoryType), dedicated(dedicated) {
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = size;
+    allocInfo.memoryTypeIndex = memoryType;
+
+    if(vkAllocateMemory(device->getDevice(), &allocInfo, nullptr, &memory) != VK_SUCCESS) {
+        throw std::runtime_error("FAILED TO ALLOCATE DEVICE MEMORY BLOCK");
+    }
+
+    //host visible blocks stay mapped for their whole life, vkMapMemory can't be called twice on the same memory
+    if(hostVisible) {
+        if(vkMapMemory(device->getDevice(), memory, 0, VK_WHOLE_SIZE, 0, &mapped) != VK_SUCCESS) {
+            vkFreeMemory(device->getDevice(), memory, nullptr);
+            throw std::runtime_error("FAILED TO MAP DEVICE MEMORY BLOCK");
+        }
+    }
+
+    freeRanges[0] = size;
+}
+
+MemoryBlock::~MemoryBlock() {
+    if(mapped != nullptr)
+        vkUnmapMemory(device->getDevice(), memory);
+    vkFreeMemory(device->getDevice(), memory, nullptr);
+}
+
+bool MemoryBlock::allocate(VkDeviceSize allocSize, VkDeviceSize alignment, Allocation& allocation) {
+    //best fit, pick the smallest free range the request fits in to keep the big ranges intact
+    auto best = freeRanges.end();
+    for(auto it = freeRanges.begin(); it != freeRanges.end(); it++) {
+        VkDeviceSize padding = alignUp(it->first, alignment) - it->first;
+        if(padding + allocSize > it->second)
+            continue;
+        if(best == freeRanges.end() || it->second < best->second)
+            best = it;
+    }
+
+    if(best == freeRanges.end())
+        return false;
+
+    VkDeviceSize rangeOffset = best->first;
+    VkDeviceSize offset = alignUp(rangeOffset, alignment);
+    VkDeviceSize rangeSize = offset - rangeOffset + allocSize;
+    VkDeviceSize remaining = best->second - rangeSize;
+    freeRanges.erase(best);
+    if(remaining > 0)
+        freeRanges[rangeOffset + rangeSize] = remaining;
+
+    allocation.memory = memory;
+    allocation.offset = offset;
+    allocation.size = allocSize;
+    allocation.mapped = mapped != nullptr ? static_cast<char*>(mapped) + offset : nullptr;
+    allocation.memoryType = memoryType;
+    allocation.block = this;
+    allocation.rangeOffset = rangeOffset;
+    allocation.rangeSize = rangeSize;
+    allocationCount++;
+    return true;
+}
+
+void MemoryBlock::free(const Allocation& allocation) {
+    auto it = freeRanges.emplace(allocation.rangeOffset, allocation.rangeSize).first;
+
+    //merge with the neighbouring free ranges so the list doesn't fragment over time
+    auto next = std::next(it);
+    if(next != freeRanges.end() && it->first + it->second == next->first) {
+        it->second += next->second;
+        freeRanges.erase(next);
+    }
+    if(it != freeRanges.begin()) {
+        auto prev = std::prev(it);
+        if(prev->first + prev->second == it->first) {
+            prev->second += it->second;
+            freeRanges.erase(it);
+        }
+    }
+
+    allocationCount--;
+}
+
+VkDeviceSize MemoryBlock::getFreeBytes() {
+    VkDeviceSize total = 0;
+    for(const auto& range : freeRanges) {
+        total += range.second;
+    }
+    return total;
+}
+
+VkDeviceSize MemoryBlock::getLargestFreeRange() {
+    VkDeviceSize largest = 0;
+    for(const auto& range : freeRanges) {
+        largest = std::max(largest, range.second);
+    }
+    return largest;
+}
+
+MemoryAllocator::MemoryAllocator(Device* device, VkDeviceSize blockSize) :
+    device(device), blockSize(blockSize) {
+    bufferImageGranularity = device->getProperties().limits.bufferImageGranularity;
+    maxAllocationCount = device->getProperties().limits.maxMemoryAllocationCount;
+    pools.resize(device->getMemoryProperties().memoryTypeCount * 2);
+}
+
+MemoryAllocator::~MemoryAllocator() {
+    if(allocationCount != 0) {
+        std::cerr << "MemoryAllocator destroyed with " << allocationCount << " live allocations" << std::endl;
+    }
+    pools.clear();
+}
+
+std::vector<std::unique_ptr<MemoryBlock>>& MemoryAllocator::getPool(uint32_t memoryType, bool linear) {
+    //buffers and optimal images only need separate blocks if the device can't place them next to each other
+    bool separate = !linear && bufferImageGranularity > 1;
+    return pools[memoryType * 2 + (separate ? 1 : 0)];
+}
+
+MemoryBlock* MemoryAllocator::createBlock(uint32_t memoryType, VkDeviceSize size, bool dedicated) {
+    if(deviceMemoryCount >= maxAllocationCount) {
+        throw std::runtime_error("EXCEEDED MAX MEMORY ALLOCATION COUNT");
+    }
+
+    bool hostVisible = device->getMemoryProperties().memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+
+    MemoryBlock* block = new MemoryBlock(device, memoryType, size, hostVisible, dedicated);
+    deviceMemoryCount++;
+    return block;
+}
+
+bool MemoryAllocator::isCoherent(uint32_t memoryType) {
+    VkMemoryPropertyFlags flags = device->getMemoryProperties().memoryTypes[memoryType].propertyFlags;
+    return !(flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) || (flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+}
+
+Allocation MemoryAllocator::allocate(const VkMemoryRequirements& memRequirements, VkMemoryPropertyFlags properties, MemoryUsage usage, bool linear) {
+    uint32_t memoryType = findMemoryType(device, memRequirements.memoryTypeBits, properties, 0, usage);
+
+    //non coherent memory is flushed and invalidated in whole atoms, so keep allocations from sharing one
+    VkMemoryRequirements requirements = memRequirements;
+    if(!isCoherent(memoryType)) {
+        VkDeviceSize atom = device->getProperties().limits.nonCoherentAtomSize;
+        requirements.alignment = std::max(requirements.alignment, atom);
+        requirements.size = alignUp(requirements.size, atom);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto& pool = getPool(memoryType, linear);
+    Allocation allocation;
+    bool allocated = false;
+
+    //large resources get memory of their own, otherwise they would leave most of a block unusable
+    if(requirements.size > blockSize / 2) {
+        MemoryBlock* block = createBlock(memoryType, requirements.size, true);
+        pool.emplace_back(block);
+        allocated = block->allocate(requirements.size, requirements.alignment, allocation);
+    } else {
+        for(auto& block : pool) {
+            if(!block->isDedicated() && block->allocate(requirements.size, requirements.alignment, allocation)) {
+                allocated = true;
+                break;
+            }
+        }
+        if(!allocated) {
+            MemoryBlock* block = createBlock(memoryType, blockSize, false);
+            pool.emplace_back(block);
+            allocated = block->allocate(requirements.size, requirements.alignment, allocation);
+        }
+    }
+
+    if(!allocated) {
+        throw std::runtime_error("FAILED TO SUB ALLOCATE DEVICE MEMORY");
+    }
+
+    allocationCount++;
+    bytesUsed += allocation.size;
+    bytesWasted += allocation.rangeSize - allocation.size;
+    return allocation;
+}
+
+void MemoryAllocator::free(Allocation& allocation) {
+    if(allocation.block == nullptr)
+        return;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    MemoryBlock* block = allocation.block;
+    block->free(allocation);
+    allocationCount--;
+    bytesUsed -= allocation.size;
+    bytesWasted -= allocation.rangeSize - allocation.size;
+    allocation = Allocation{};
+
+    if(!block->isEmpty())
+        return;
+
+    //keep one empty block around per pool so a free/allocate cycle doesn't hit the driver every time
+    for(auto& pool : pools) {
+        auto it = std::find_if(pool.begin(), pool.end(), [block](const std::unique_ptr<MemoryBlock>& b) { return b.get() == block; });
+        if(it == pool.end())
+            continue;
+
+        size_t emptyBlocks = std::count_if(pool.begin(), pool.end(), [](const std::unique_ptr<MemoryBlock>& b) { return b->isEmpty() && !b->isDedicated(); });
+        if(block->isDedicated() || emptyBlocks > 1) {
+            pool.erase(it);
+            deviceMemoryCount--;
+        }
+        return;
+    }
+}
+
+void MemoryAllocator::flush(const Allocation& allocation) {
+    if(isCoherent(allocation.memoryType))
+        return;
+
+    VkMappedMemoryRange range{};
+    range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+    range.memory = allocation.memory;
+    range.offset = allocation.offset;
+    range.size = allocation.size;
+    vkFlushMappedMemoryRanges(device->getDevice(), 1, &range);
+}
+
+void MemoryAllocator::invalidate(const Allocation& allocation) {
+    if(isCoherent(allocation.memoryType))
+        return;
+
+    VkMappedMemoryRange range{};
+    range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+    range.memory = allocation.memory;
+    range.offset = allocation.offset;
+    range.size = allocation.size;
+    vkInvalidateMappedMemoryRanges(device->getDevice(), 1, &range);
+}
+
+MemoryStats MemoryAllocator::getStats() {
+    std::lock_guard<std::mutex> lock(mutex);
+    MemoryStats stats{};
+    stats.deviceMemoryCount = deviceMemoryCount;
+    stats.allocationCount = allocationCount;
+    stats.bytesUsed = bytesUsed;
+    stats.bytesWasted = bytesWasted;
+
+    VkDeviceSize freeBytes = 0;
+    VkDeviceSize largestFree = 0;
+    for(auto& pool : pools) {
+        for(auto& block : pool) {
+            stats.bytesReserved += block->getSize();
+            if(block->isDedicated())
+                continue;
+            freeBytes += block->getFreeBytes();
+            largestFree = std::max(largestFree, block->getLargestFreeRange());
+        }
+    }
+    if(freeBytes > 0)
+        stats.fragmentation = 1.0f - static_cast<float>(largestFree) / static_cast<float>(freeBytes);
+
+    return stats;
+}
+
+void MemoryAllocator::printStats() {
+    MemoryStats stats = getStats();
+    std::cout << "Memory: " << stats.allocationCount << " allocations in " << stats.deviceMemoryCount << " device memory blocks (limit " << maxAllocationCount << ")" << std::endl;
+    std::cout << "Memory: " << stats.bytesUsed << " bytes used / " << stats.bytesReserved << " bytes reserved, "
+        << stats.bytesWasted << " bytes wasted to alignment, fragmentation " << stats.fragmentation << std::endl;
+}
@@ -1,15 +1,96 @@
+#include "device.h"
+#include <bitset>
 #include <memory_util.h>
 #include <stdexcept>
+#include <vulkan/vulkan_core.h>
+
+//flags nobody asks for by accident, a type that has them is only picked when they are required
+const VkMemoryPropertyFlags EXOTIC_MEMORY_PROPERTIES = VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT | VK_MEMORY_PROPERTY_PROTECTED_BIT | VK_MEMORY_PROPERTY_DEVICE_COHERENT_BIT_AMD;
+
+static VkMemoryPropertyFlags getUsageRequiredFlags(MemoryUsage usage) {
+    switch(usage) {
+    case MEMORY_USAGE_UPLOAD:
+    case MEMORY_USAGE_READBACK:
+    case MEMORY_USAGE_DYNAMIC:
+        return VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+    default:
+        return 0;
+    }
+}
+
+static int scoreMemoryType(VkMemoryPropertyFlags flags, VkMemoryPropertyFlags preferred, MemoryUsage usage) {
+    int score = 4 * static_cast<int>(std::bitset<32>(flags & preferred).count());
+
+    bool deviceLocal = flags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+    bool hostVisible = flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+    bool hostCoherent = flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    bool hostCached = flags & VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+
+    switch(usage) {
+    case MEMORY_USAGE_GPU_ONLY:
+        //leave host visible device memory (rebar) free for the resources the cpu writes to
+        score += deviceLocal ? 16 : 0;
+        score -= hostVisible ? 2 : 0;
+        break;
+    case MEMORY_USAGE_UPLOAD:
+        //plain write combined system memory, the copy does the trip to vram
+        score += hostCoherent ? 4 : 0;
+        score -= deviceLocal ? 2 : 0;
+        score -= hostCached ? 1 : 0;
+        break;
+    case MEMORY_USAGE_READBACK:
+        //uncached reads from the cpu are extremely slow
+        score += hostCached ? 16 : 0;
+        score += hostCoherent ? 1 : 0;
+        break;
+    case MEMORY_USAGE_DYNAMIC:
+        //device local + host visible lets the gpu read the data without a copy
+        score += deviceLocal ? 16 : 0;
+        score += hostCoherent ? 4 : 0;
+        score -= hostCached ? 1 : 0;
+        break;
+    default:
+        break;
+    }
+
+    return score;
+}
 
 uint32_t findMemoryType(Device* device, uint32_t typeFilter, VkMemoryPropertyFlags properties) {
-    VkPhysicalDeviceMemoryProperties memProperties;
-    vkGetPhysicalDeviceMemoryProperties(device->getPhysicalDevices(), &memProperties);
+    return findMemoryType(device, typeFilter, properties, 0, MEMORY_USAGE_UNKNOWN);
+}
+
+uint32_t findMemoryType(Device* device, uint32_t typeFilter, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred, MemoryUsage usage) {
+    const VkPhysicalDeviceMemoryProperties& memProperties = device->getMemoryProperties();
+    required |= getUsageRequiredFlags(usage);
 
+    bool found = false;
+    uint32_t bestType = 0;
+    int bestScore = 0;
+    VkDeviceSize bestHeapSize = 0;
     for(uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
-        if((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
-            return i;
+        VkMemoryPropertyFlags flags = memProperties.memoryTypes[i].propertyFlags;
+        if(!(typeFilter & (1 << i)) || (flags & required) != required) {
+            continue;
         }
+        if(flags & EXOTIC_MEMORY_PROPERTIES & ~(required | preferred)) {
+            continue;
+        }
+
+        int score = scoreMemoryType(flags, preferred, usage);
+        VkDeviceSize heapSize = memProperties.memoryHeaps[memProperties.memoryTypes[i].heapIndex].size;
+        //on a tie prefer the larger heap, small device local + host visible heaps fill up fast
+        if(!found || score > bestScore || (score == bestScore && heapSize > bestHeapSize)) {
+            found = true;
+            bestType = i;
+            bestScore = score;
+            bestHeapSize = heapSize;
+        }
+    }
+
+    if(!found) {
+        throw std::runtime_error("FAILED TO FIND SUITABLE MEMORY TYPE FOR BUFFER");
     }
 
-    throw std::runtime_error("FAILED TO FIND SUITABLE MEMORY TYPE FOR BUFFER");
-}
\ No newline at end of file
+    return bestType;
+}
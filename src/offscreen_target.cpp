@@ -0,0 +1,138 @@
+#include "buffer.h"
+#include "image.h"
+#include "imageview.h"
+#include "memory_util.h"
+#include "timeline_semaphore.h"
+#include <cstdint>
+#include <offscreen_target.h>
+#include <stdexcept>
+#include <vulkan/vulkan_core.h>
+
+static uint32_t getFormatSize(VkFormat format) {
+    switch(format) {
+        case VK_FORMAT_R8G8B8A8_SRGB:
+        case VK_FORMAT_R8G8B8A8_UNORM:
+        case VK_FORMAT_B8G8R8A8_SRGB:
+        case VK_FORMAT_B8G8R8A8_UNORM:
+            return 4;
+        default:
+            throw std::runtime_error("UNSUPPORTED OFFSCREEN TARGET FORMAT");
+    }
+}
+
+OffscreenTarget::OffscreenTarget(Device* device, VkExtent2D extent, uint32_t imageCount, VkFormat format) :
+    device(device), extent(extent), format(format) {
+    VkDeviceSize readbackSize = static_cast<VkDeviceSize>(extent.width) * extent.height * getFormatSize(format);
+
+    slots.resize(imageCount);
+    for(auto& slot : slots) {
+        slot.image = std::unique_ptr<Image>(new Image(device, extent.width, extent.height, format, VK_IMAGE_TILING_OPTIMAL,
+            VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT));
+        slot.view = std::unique_ptr<ImageView>(new ImageView(device, slot.image->getHandle(), format, VK_IMAGE_ASPECT_COLOR_BIT));
+        slot.readback = std::unique_ptr<Buffer>(new Buffer(device, readbackSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_SHARING_MODE_EXCLUSIVE,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, MEMORY_USAGE_READBACK));
+    }
+    //start on the last slot so the first swap lands on image 0
+    imageIndex = imageCount - 1;
+}
+
+//the readback buffers can't be freed while a copy into them is still running
+OffscreenTarget::~OffscreenTarget() {
+    for(auto& slot : slots) {
+        if(slot.pending)
+            slot.point.wait();
+    }
+}
+
+//the frame scheduler has already waited for the frame that last used the next image,
+//so its readback is always complete here and can be delivered before the image is reused
+bool OffscreenTarget::swap(Semaphore* semaphore) {
+    if(semaphore != nullptr) {
+        throw std::runtime_error("OFFSCREEN TARGETS CAN'T SIGNAL AN ACQUIRE SEMAPHORE");
+    }
+    imageIndex = (imageIndex + 1) % slots.size();
+    collectReadbacks();
+    if(slots[imageIndex].pending) {
+        slots[imageIndex].point.wait();
+        deliver(slots[imageIndex]);
+    }
+    return true;
+}
+
+//the frame's submission signals the point recordFinish was given, nothing to wait on here
+bool OffscreenTarget::present(std::vector<Semaphore*>) {
+    Slot& slot = slots[imageIndex];
+    slot.frameNumber = frameCount++;
+    slot.pending = true;
+    return true;
+}
+
+//the copy is done once the frame's own point is reached, other submissions on the graphics timeline don't matter
+void OffscreenTarget::recordFinish(CommandBuffer* cmdBuffer, TimelinePoint signal) {
+    Slot& slot = slots[imageIndex];
+    slot.point = signal;
+
+    VkBufferImageCopy region{};
+    region.bufferOffset = 0;
+    region.bufferRowLength = 0;
+    region.bufferImageHeight = 0;
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.mipLevel = 0;
+    region.imageSubresource.baseArrayLayer = 0;
+    region.imageSubresource.layerCount = 1;
+    region.imageOffset = {0, 0, 0};
+    region.imageExtent = {extent.width, extent.height, 1};
+    vkCmdCopyImageToBuffer(cmdBuffer->getHandle(), slot.image->getHandle(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, slot.readback->getHandle(), 1, &region);
+
+    VkBufferMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.buffer = slot.readback->getHandle();
+    barrier.offset = 0;
+    barrier.size = VK_WHOLE_SIZE;
+    vkCmdPipelineBarrier(cmdBuffer->getHandle(), VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+}
+
+void OffscreenTarget::deliver(Slot& slot) {
+    slot.readback->invalidate();
+    slot.pending = false;
+    readbackCount++;
+    if(!readbackCallback)
+        return;
+
+    ReadbackFrame frame{};
+    frame.frameNumber = slot.frameNumber;
+    frame.data = slot.readback->mapBuffer();
+    frame.size = slot.readback->getSize();
+    frame.extent = extent;
+    frame.format = format;
+    readbackCallback(frame);
+}
+
+//delivers every readback the gpu has finished, in frame order, without blocking
+uint32_t OffscreenTarget::collectReadbacks() {
+    uint32_t delivered = 0;
+    while(true) {
+        Slot* oldest = nullptr;
+        for(auto& slot : slots) {
+            if(slot.pending && (oldest == nullptr || slot.frameNumber < oldest->frameNumber))
+                oldest = &slot;
+        }
+        if(oldest == nullptr || !oldest->point.isReached())
+            return delivered;
+        deliver(*oldest);
+        delivered++;
+    }
+}
+
+//blocks until every submitted frame has been read back
+void OffscreenTarget::flushReadbacks() {
+    for(auto& slot : slots) {
+        if(slot.pending)
+            slot.point.wait();
+    }
+    collectReadbacks();
+}
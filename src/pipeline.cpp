@@ -1,69 +1,71 @@
-#include "global_config.h"
+#include "pipeline_cache.h"
 #include "shader.h"
-#include "swapchain.h"
-#include <array>
+#include "shader_library.h"
+#include <chrono>
 #include <cstdint>
 #include <iostream>
+#include <memory>
 #include <pipeline.h>
-#include <sstream>
 #include <stdexcept>
 #include <string>
 #include <vector>
 #include <vulkan/vulkan_core.h>
 
-VkShaderStageFlagBits getStageFromFilename(const char* fileName) {
-    std::string name(fileName);
-    std::stringstream stream(name);
-    std::vector<std::string> tokens;
-    std::string temp;
-    while(std::getline(stream, temp, '.')) {
-        tokens.push_back(temp);
-    }
-
-    std::string shaderTypeString = tokens[tokens.size()-2];
-    if (shaderTypeString == std::string("vert")) {
-        return VK_SHADER_STAGE_VERTEX_BIT;
-    } else if (shaderTypeString == std::string("frag")) {
-        return VK_SHADER_STAGE_FRAGMENT_BIT;
-    }
-
-    return VK_SHADER_STAGE_ALL;
-}
-
-Pipeline::Pipeline(Device* device, const std::vector<const char*> shaderFiles, SwapChain* swapchain, VkRenderPass renderPass) :
-    device(device), renderPass(renderPass) {
-    std::vector<Shader> shaders;
+Pipeline::Pipeline(Device* device, const PipelineKey& key, VkPipelineCache cache) :
+    device(device), layout(key.layout), dynamicState(key.dynamicState) {
+    const std::vector<std::string>& shaderFiles = key.shaderFiles;
+    std::vector<std::shared_ptr<Shader>> shaders;
     shaders.reserve(shaderFiles.size());
     std::vector<VkPipelineShaderStageCreateInfo> shaderStageCreateInfos;
     shaderStageCreateInfos.reserve(shaderFiles.size());
 
-    for(auto shaderFile : shaderFiles) {
-        shaders.emplace_back(device, shaderFile);
+    //each stage gets the constants meant for it, the vectors are sized up front so the pointers stay valid
+    std::vector<std::vector<VkSpecializationMapEntry>> specializationEntries(shaderFiles.size());
+    std::vector<std::vector<uint32_t>> specializationData(shaderFiles.size());
+    std::vector<VkSpecializationInfo> specializationInfos(shaderFiles.size());
+
+    for(size_t i = 0; i < shaderFiles.size(); i++) {
+        shaders.push_back(device->getShaderLibrary()->load(shaderFiles[i]));
         VkPipelineShaderStageCreateInfo createInfo{};
         createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-        createInfo.stage = getStageFromFilename(shaderFile);
-        createInfo.module = shaders[shaders.size()-1].getShader();
+        createInfo.stage = shaders[i]->getStage();
+        createInfo.module = shaders[i]->getShader();
         createInfo.pName = "main";
+
+        for(const auto& constant : key.specialization) {
+            if(!(constant.stages & createInfo.stage))
+                continue;
+            VkSpecializationMapEntry entry{};
+            entry.constantID = constant.constantID;
+            entry.offset = static_cast<uint32_t>(specializationData[i].size() * sizeof(uint32_t));
+            entry.size = sizeof(uint32_t);
+            specializationEntries[i].push_back(entry);
+            specializationData[i].push_back(constant.value);
+        }
+        if(!specializationEntries[i].empty()) {
+            specializationInfos[i].mapEntryCount = static_cast<uint32_t>(specializationEntries[i].size());
+            specializationInfos[i].pMapEntries = specializationEntries[i].data();
+            specializationInfos[i].dataSize = specializationData[i].size() * sizeof(uint32_t);
+            specializationInfos[i].pData = specializationData[i].data();
+            createInfo.pSpecializationInfo = &specializationInfos[i];
+        }
+
         shaderStageCreateInfos.push_back(createInfo);
     }
 
-    //Vertex input, empty for now since verticies are hard coded into the shader
+    //Vertex input, layout comes from the key so different vertex formats get their own pipelines
     VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
     vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-
-    auto bindingDescription = Vertex::getBindingDescription();
-    auto attributeDescriptions = Vertex::getAttributeDescriptions();
-
-    vertexInputInfo.vertexBindingDescriptionCount = 1;
-    vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
-    vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
-    vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
+    vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(key.vertexBindings.size());
+    vertexInputInfo.pVertexBindingDescriptions = key.vertexBindings.data();
+    vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(key.vertexAttributes.size());
+    vertexInputInfo.pVertexAttributeDescriptions = key.vertexAttributes.data();
 
     //Input Assembly, what types of primitives do we want to draw
     VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
     inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-    inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-    inputAssembly.primitiveRestartEnable = VK_FALSE;
+    inputAssembly.topology = key.topology;
+    inputAssembly.primitiveRestartEnable = key.primitiveRestart ? VK_TRUE : VK_FALSE;
 
     //creating static viewport and scissor for now, may make dynamic in future
     VkPipelineViewportStateCreateInfo viewportState{};
@@ -76,10 +78,10 @@ Pipeline::Pipeline(Device* device, const std::vector<const char*> shaderFiles, S
     rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
     rasterizer.depthClampEnable = VK_FALSE; // clamps depth values to the near and far planes instead of discarding
     rasterizer.rasterizerDiscardEnable = VK_FALSE; // disables passing anything past the rasterizer stage
-    rasterizer.polygonMode = VK_POLYGON_MODE_FILL; // how do we want polygons to render, fill, or wireframe?
+    rasterizer.polygonMode = key.polygonMode; // how do we want polygons to render, fill, or wireframe?
     rasterizer.lineWidth = 1.0f; // sets thickness of lines, any higher than 1.0 requries gpu feature
-    rasterizer.cullMode = VK_CULL_MODE_BACK_BIT; // cull the back face
-    rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE; // front face is when verts are defined clockwise
+    rasterizer.cullMode = key.cullMode; // cull the back face
+    rasterizer.frontFace = key.frontFace; // which winding counts as the front face
     rasterizer.depthBiasEnable = VK_FALSE; // can alther depth values in some way
     rasterizer.depthBiasConstantFactor = 0.0f;
     rasterizer.depthBiasClamp = 0.0f;
@@ -89,25 +91,33 @@ Pipeline::Pipeline(Device* device, const std::vector<const char*> shaderFiles, S
     VkPipelineMultisampleStateCreateInfo multisampling{};
     multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
     multisampling.sampleShadingEnable = VK_FALSE; //disabled for now. enabling requires a gpu feature
-    multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+    multisampling.rasterizationSamples = key.samples;
     multisampling.minSampleShading = 1.0f;
     multisampling.pSampleMask = nullptr;
     multisampling.alphaToCoverageEnable = VK_FALSE;
     multisampling.alphaToOneEnable = VK_FALSE;
 
-    //depth and stencil testing, disabled for now will revisit later
+    //depth and stencil testing
+    VkPipelineDepthStencilStateCreateInfo depthStencil{};
+    depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+    depthStencil.depthTestEnable = key.depthTest ? VK_TRUE : VK_FALSE;
+    depthStencil.depthWriteEnable = key.depthWrite ? VK_TRUE : VK_FALSE;
+    depthStencil.depthCompareOp = key.depthCompareOp;
+    depthStencil.depthBoundsTestEnable = VK_FALSE;
+    depthStencil.stencilTestEnable = VK_FALSE;
+    depthStencil.minDepthBounds = 0.0f;
+    depthStencil.maxDepthBounds = 1.0f;
 
     //color blending, how do we mix the new color with the color already in the frambuffer?
     VkPipelineColorBlendAttachmentState colorBlendAttachment{};
-    colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
-        VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-    colorBlendAttachment.blendEnable = VK_TRUE;
-    colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
-    colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
-    colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
-    colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
-    colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
-    colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+    colorBlendAttachment.colorWriteMask = key.colorWriteMask;
+    colorBlendAttachment.blendEnable = key.blendEnable ? VK_TRUE : VK_FALSE;
+    colorBlendAttachment.srcColorBlendFactor = key.srcColorBlendFactor;
+    colorBlendAttachment.dstColorBlendFactor = key.dstColorBlendFactor;
+    colorBlendAttachment.colorBlendOp = key.colorBlendOp;
+    colorBlendAttachment.srcAlphaBlendFactor = key.srcAlphaBlendFactor;
+    colorBlendAttachment.dstAlphaBlendFactor = key.dstAlphaBlendFactor;
+    colorBlendAttachment.alphaBlendOp = key.alphaBlendOp;
 
     VkPipelineColorBlendStateCreateInfo colorBlending{};
     colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
@@ -116,49 +126,31 @@ Pipeline::Pipeline(Device* device, const std::vector<const char*> shaderFiles, S
     colorBlending.attachmentCount = 1;
     colorBlending.pAttachments = &colorBlendAttachment;
 
-    //pipeline layout, this defines all uniforms required by pipeline shaders.
-    VkDescriptorSetLayoutBinding uboLayoutBinding{};
-    uboLayoutBinding.binding = 0;
-    uboLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    uboLayoutBinding.descriptorCount = 1;
-    uboLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
-    uboLayoutBinding.pImmutableSamplers = nullptr;
-
-    VkDescriptorSetLayoutBinding samplerLaoutBinding{};
-    samplerLaoutBinding.binding = 1;
-    samplerLaoutBinding.descriptorCount = 1;
-    samplerLaoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    samplerLaoutBinding.pImmutableSamplers = nullptr;
-    samplerLaoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-
-    std::array<VkDescriptorSetLayoutBinding, 2> bindings = {uboLayoutBinding, samplerLaoutBinding};
-
-    VkDescriptorSetLayoutCreateInfo layoutInfo{};
-    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-    layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
-    layoutInfo.pBindings = bindings.data();
-
-    if(vkCreateDescriptorSetLayout(device->getDevice(), &layoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS) {
-        throw std::runtime_error("FAILED TO CREATE DESCRIPTOR SET LAYOUT");
-    }
-
-    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    pipelineLayoutInfo.setLayoutCount = 1;
-    pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
-    pipelineLayoutInfo.pushConstantRangeCount = 0;
-    pipelineLayoutInfo.pPushConstantRanges = nullptr;
-
-    if(vkCreatePipelineLayout(device->getDevice(), &pipelineLayoutInfo, nullptr, &layout) != VK_SUCCESS) {
-        throw std::runtime_error("FAILED TO CREATE PIPELINE LAYOUT");
-    }
-
     VkPipelineDynamicStateCreateInfo dynamicState{};
     dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
     std::vector<VkDynamicState> dynamicStates = {
         VK_DYNAMIC_STATE_VIEWPORT,
         VK_DYNAMIC_STATE_SCISSOR
     };
+    if(key.dynamicState & DYNAMIC_STATE_CULL_MODE)
+        dynamicStates.push_back(VK_DYNAMIC_STATE_CULL_MODE_EXT);
+    if(key.dynamicState & DYNAMIC_STATE_FRONT_FACE)
+        dynamicStates.push_back(VK_DYNAMIC_STATE_FRONT_FACE_EXT);
+    if(key.dynamicState & DYNAMIC_STATE_TOPOLOGY)
+        dynamicStates.push_back(VK_DYNAMIC_STATE_PRIMITIVE_TOPOLOGY_EXT);
+    if(key.dynamicState & DYNAMIC_STATE_DEPTH) {
+        dynamicStates.push_back(VK_DYNAMIC_STATE_DEPTH_TEST_ENABLE_EXT);
+        dynamicStates.push_back(VK_DYNAMIC_STATE_DEPTH_WRITE_ENABLE_EXT);
+        dynamicStates.push_back(VK_DYNAMIC_STATE_DEPTH_COMPARE_OP_EXT);
+    }
+    if(key.dynamicState & DYNAMIC_STATE_PRIMITIVE_RESTART)
+        dynamicStates.push_back(VK_DYNAMIC_STATE_PRIMITIVE_RESTART_ENABLE_EXT);
+    if(key.dynamicState & DYNAMIC_STATE_POLYGON_MODE)
+        dynamicStates.push_back(VK_DYNAMIC_STATE_POLYGON_MODE_EXT);
+    if(key.dynamicState & DYNAMIC_STATE_BLEND_ENABLE)
+        dynamicStates.push_back(VK_DYNAMIC_STATE_COLOR_BLEND_ENABLE_EXT);
+    if(key.dynamicState & DYNAMIC_STATE_COLOR_WRITE_MASK)
+        dynamicStates.push_back(VK_DYNAMIC_STATE_COLOR_WRITE_MASK_EXT);
 
     dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
     dynamicState.pDynamicStates = dynamicStates.data();
@@ -172,33 +164,48 @@ Pipeline::Pipeline(Device* device, const std::vector<const char*> shaderFiles, S
     pipelineInfo.pViewportState = &viewportState;
     pipelineInfo.pRasterizationState = &rasterizer;
     pipelineInfo.pMultisampleState = &multisampling;
-    pipelineInfo.pDepthStencilState = nullptr; //will address later
+    pipelineInfo.pDepthStencilState = &depthStencil;
     pipelineInfo.pColorBlendState = &colorBlending;
     pipelineInfo.pDynamicState = &dynamicState;
 
     pipelineInfo.layout = layout;
-    pipelineInfo.renderPass = renderPass;
-    pipelineInfo.subpass = 0;
+    pipelineInfo.renderPass = key.renderPass;
+    pipelineInfo.subpass = key.subpass;
+
+    VkPipelineRenderingCreateInfoKHR renderingInfo{};
+    if(key.renderPass == VK_NULL_HANDLE) {
+        renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO_KHR;
+        renderingInfo.colorAttachmentCount = static_cast<uint32_t>(key.colorFormats.size());
+        renderingInfo.pColorAttachmentFormats = key.colorFormats.data();
+        renderingInfo.depthAttachmentFormat = key.depthFormat;
+        renderingInfo.stencilAttachmentFormat = VK_FORMAT_UNDEFINED;
+        pipelineInfo.pNext = &renderingInfo;
+    }
 
     pipelineInfo.basePipelineHandle = nullptr;
     pipelineInfo.basePipelineIndex = -1;
 
-    if(vkCreateGraphicsPipelines(device->getDevice(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS) {
+    //compile threads pass their own cache, everyone else shares the device one
+    PipelineCache* deviceCache = device->getPipelineCache();
+    if(cache == VK_NULL_HANDLE)
+        cache = deviceCache->getHandle();
+    auto start = std::chrono::high_resolution_clock::now();
+    if(vkCreateGraphicsPipelines(device->getDevice(), cache, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS) {
         throw std::runtime_error("FAILED TO CREATE GRAPHICS PIPELINE");
     }
+    double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    deviceCache->recordCreation(milliseconds);
     
-    std::cout << "Graphics Pipeline created" << std::endl;
+    std::cout << "Graphics Pipeline created in " << milliseconds << "ms (" << (deviceCache->isWarm() ? "warm" : "cold") << " cache)" << std::endl;
 
 }
 
 Pipeline::~Pipeline() {
 
     vkDestroyPipeline(device->getDevice(), pipeline, nullptr);
-    vkDestroyPipelineLayout(device->getDevice(), layout, nullptr);
-    vkDestroyDescriptorSetLayout(device->getDevice(), descriptorSetLayout, nullptr);
 
 }
 
 void Pipeline::bind(CommandBuffer* buffer) {
-    vkCmdBindPipeline(buffer->getHandle(), VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+    buffer->bindPipeline(VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline, dynamicState);
 }
\ No newline at end of file
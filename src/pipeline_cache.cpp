@@ -0,0 +1,136 @@
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <mutex>
+#include <pipeline_cache.h>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <vulkan/vulkan_core.h>
+
+PipelineCache::PipelineCache(Device* device, const std::string& path) :
+    device(device), path(path) {
+    std::string data;
+    std::ifstream file(path, std::ios::binary);
+    if(file) {
+        data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+
+    if(!data.empty() && !validateHeader(data)) {
+        data.clear();
+    }
+    warm = !data.empty();
+
+    VkPipelineCacheCreateInfo createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    createInfo.initialDataSize = data.size();
+    createInfo.pInitialData = data.empty() ? nullptr : data.data();
+
+    if(vkCreatePipelineCache(device->getDevice(), &createInfo, nullptr, &cache) != VK_SUCCESS) {
+        throw std::runtime_error("FAILED TO CREATE PIPELINE CACHE");
+    }
+
+    std::cout << "Pipeline cache " << (warm ? "loaded " + std::to_string(data.size()) + " bytes from " + path : "starting cold") << std::endl;
+}
+
+PipelineCache::~PipelineCache() {
+    printStats();
+    save();
+    vkDestroyPipelineCache(device->getDevice(), cache, nullptr);
+}
+
+//drivers are supposed to reject foreign data themselves, but not all of them do it gracefully
+bool PipelineCache::validateHeader(const std::string& data) {
+    VkPipelineCacheHeaderVersionOne header{};
+    if(data.size() < sizeof(header)) {
+        std::cout << "Pipeline cache " << path << " is truncated, ignoring it" << std::endl;
+        return false;
+    }
+    memcpy(&header, data.data(), sizeof(header));
+
+    const VkPhysicalDeviceProperties& properties = device->getProperties();
+    if(header.headerSize < sizeof(header) || header.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE) {
+        std::cout << "Pipeline cache " << path << " has an unknown header, ignoring it" << std::endl;
+        return false;
+    }
+    if(header.vendorID != properties.vendorID || header.deviceID != properties.deviceID ||
+        memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) != 0) {
+        std::cout << "Pipeline cache " << path << " was written by a different device or driver, ignoring it" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+//seeded with everything in the device cache so worker threads still get warm hits
+VkPipelineCache PipelineCache::createWorkerCache() {
+    std::vector<char> data;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        size_t size = 0;
+        if(vkGetPipelineCacheData(device->getDevice(), cache, &size, nullptr) == VK_SUCCESS && size > 0) {
+            data.resize(size);
+            if(vkGetPipelineCacheData(device->getDevice(), cache, &size, data.data()) != VK_SUCCESS)
+                data.clear();
+        }
+    }
+
+    VkPipelineCacheCreateInfo createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    createInfo.initialDataSize = data.size();
+    createInfo.pInitialData = data.empty() ? nullptr : data.data();
+
+    VkPipelineCache workerCache;
+    if(vkCreatePipelineCache(device->getDevice(), &createInfo, nullptr, &workerCache) != VK_SUCCESS) {
+        throw std::runtime_error("FAILED TO CREATE PIPELINE CACHE");
+    }
+    return workerCache;
+}
+
+//takes ownership of the worker cache
+void PipelineCache::merge(VkPipelineCache workerCache) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if(vkMergePipelineCaches(device->getDevice(), cache, 1, &workerCache) != VK_SUCCESS) {
+        std::cerr << "Failed to merge worker pipeline cache" << std::endl;
+    }
+    vkDestroyPipelineCache(device->getDevice(), workerCache, nullptr);
+}
+
+//written to a temporary file and renamed over the old one, a crash mid write can't leave a corrupt cache behind
+void PipelineCache::save() {
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t size = 0;
+    if(vkGetPipelineCacheData(device->getDevice(), cache, &size, nullptr) != VK_SUCCESS || size == 0)
+        return;
+    std::vector<char> data(size);
+    if(vkGetPipelineCacheData(device->getDevice(), cache, &size, data.data()) != VK_SUCCESS)
+        return;
+
+    std::string tempPath = path + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if(!file.write(data.data(), size)) {
+            std::cerr << "Failed to write pipeline cache to " << tempPath << std::endl;
+            return;
+        }
+    }
+    if(std::rename(tempPath.c_str(), path.c_str()) != 0) {
+        std::cerr << "Failed to move pipeline cache into place at " << path << std::endl;
+        std::remove(tempPath.c_str());
+        return;
+    }
+    std::cout << "Pipeline cache saved " << size << " bytes to " << path << std::endl;
+}
+
+void PipelineCache::recordCreation(double milliseconds) {
+    std::lock_guard<std::mutex> lock(mutex);
+    pipelineCount++;
+    creationMilliseconds += milliseconds;
+}
+
+void PipelineCache::printStats() {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::cout << "Pipeline cache: " << pipelineCount << " pipelines created in " << creationMilliseconds << "ms from a "
+        << (warm ? "warm" : "cold") << " cache" << std::endl;
+}
@@ -0,0 +1,189 @@
+#include "pipeline.h"
+#include "pipeline_cache.h"
+#include <chrono>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <pipeline_compiler.h>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include <vulkan/vulkan_core.h>
+
+bool PipelineHandle::isReady() {
+    return done.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
+
+void PipelineHandle::wait() {
+    done.wait();
+}
+
+//null until the compile finishes, throws if it failed so a broken shader doesn't silently draw nothing forever
+Pipeline* PipelineHandle::get() {
+    if(!isReady())
+        return nullptr;
+    if(!error.empty()) {
+        throw std::runtime_error(error);
+    }
+    return pipeline.get();
+}
+
+//leaves one core for the render thread, hardware_concurrency can be 0 when it isn't known
+PipelineCompiler::PipelineCompiler(Device* device, uint32_t threadCount) :
+    device(device) {
+    if(threadCount == 0) {
+        unsigned hc = std::thread::hardware_concurrency();
+        threadCount = hc > 1 ? hc - 1 : 1;
+    }
+    for(uint32_t i = 0; i < threadCount; i++) {
+        workers.emplace_back(&PipelineCompiler::workerLoop, this);
+    }
+    std::cout << "Pipeline compiler started with " << threadCount << " threads" << std::endl;
+}
+
+PipelineCompiler::~PipelineCompiler() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    condition.notify_all();
+    for(auto& worker : workers) {
+        worker.join();
+    }
+
+    //anything still queued is never compiled, fail the handles so nobody waits on them forever
+    for(auto& job : jobs) {
+        job.handle->error = "PIPELINE COMPILER SHUT DOWN BEFORE COMPILING PIPELINE";
+        job.handle->promise.set_value();
+    }
+
+    //handles can outlive the compiler, but the pipelines inside them can't outlive the device
+    printStats();
+    for(auto& entry : pipelines) {
+        entry.second->pipeline.reset();
+    }
+    pipelines.clear();
+}
+
+//an equal key returns the existing handle even if its compile is still queued
+std::shared_ptr<PipelineHandle> PipelineCompiler::compile(const PipelineKey& requested) {
+    PipelineKey key = requested.canonical();
+    std::shared_ptr<PipelineHandle> handle;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = pipelines.find(key);
+        if(it != pipelines.end()) {
+            hits++;
+            return it->second;
+        }
+        misses++;
+        handle = std::make_shared<PipelineHandle>();
+        pipelines.emplace(key, handle);
+        jobs.push_back(Job{key, handle});
+    }
+    condition.notify_one();
+    return handle;
+}
+
+//always compiles, for when the shaders behind the key changed on disk. whoever holds the old handle keeps
+//using it until the new one is ready and then hands it to retire
+std::shared_ptr<PipelineHandle> PipelineCompiler::recompile(const PipelineKey& requested) {
+    PipelineKey key = requested.canonical();
+    std::shared_ptr<PipelineHandle> handle = std::make_shared<PipelineHandle>();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        misses++;
+        pipelines[key] = handle;
+        jobs.push_back(Job{key, handle});
+    }
+    condition.notify_one();
+    return handle;
+}
+
+//frames still in flight may have the old pipeline bound
+void PipelineCompiler::retire(std::shared_ptr<PipelineHandle> handle) {
+    {
+        //a cached handle with its pipeline moved out would make later hits draw nothing
+        std::lock_guard<std::mutex> lock(mutex);
+        for(auto it = pipelines.begin(); it != pipelines.end(); it++) {
+            if(it->second == handle) {
+                pipelines.erase(it);
+                break;
+            }
+        }
+    }
+    handle->wait();
+    if(handle->pipeline)
+        device->defer(std::move(handle->pipeline));
+}
+
+//pipelines are keyed on the render pass handle, once it is destroyed a new pass could get the same handle back
+void PipelineCompiler::releaseRenderPass(VkRenderPass renderPass) {
+    std::vector<std::shared_ptr<PipelineHandle>> released;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for(auto it = pipelines.begin(); it != pipelines.end();) {
+            if(it->first.renderPass == renderPass) {
+                released.push_back(it->second);
+                it = pipelines.erase(it);
+            } else {
+                it++;
+            }
+        }
+    }
+
+    for(auto& handle : released) {
+        retire(handle);
+    }
+}
+
+void PipelineCompiler::workerLoop() {
+    PipelineCache* deviceCache = device->getPipelineCache();
+    VkPipelineCache cache = deviceCache->createWorkerCache();
+
+    while(true) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            condition.wait(lock, [this]() { return stopping || !jobs.empty(); });
+            if(stopping)
+                break;
+            job = jobs.front();
+            jobs.pop_front();
+        }
+
+        try {
+            job.handle->pipeline = std::unique_ptr<Pipeline>(new Pipeline(device, job.key, cache));
+        } catch(const std::exception& e) {
+            job.handle->error = e.what();
+        }
+        job.handle->promise.set_value();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        compiledCount++;
+    }
+
+    deviceCache->merge(cache);
+}
+
+uint32_t PipelineCompiler::getCompiledCount() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return compiledCount;
+}
+
+uint64_t PipelineCompiler::getHitCount() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return hits;
+}
+
+uint64_t PipelineCompiler::getMissCount() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return misses;
+}
+
+void PipelineCompiler::printStats() {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::cout << "Pipeline compiler: " << pipelines.size() << " unique pipelines, " << hits << " hits / " << misses << " misses, "
+        << compiledCount << " compiled" << std::endl;
+}
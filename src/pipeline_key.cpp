@@ -0,0 +1,177 @@
+#include "device.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <pipeline_key.h>
+#include <string>
+#include <vulkan/vulkan_core.h>
+
+//boost style hash_combine, spreads small enum values across the whole word
+static void hashCombine(size_t& seed, uint64_t value) {
+    seed ^= std::hash<uint64_t>()(value) + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2);
+}
+
+static void hashCombine(size_t& seed, const void* handle) {
+    hashCombine(seed, static_cast<uint64_t>(reinterpret_cast<uintptr_t>(handle)));
+}
+
+uint32_t getSupportedDynamicState(Device* device) {
+    const ExtendedDynamicState& support = device->getExtendedDynamicState();
+    uint32_t mask = 0;
+    if(support.state1)
+        mask |= DYNAMIC_STATE_CULL_MODE | DYNAMIC_STATE_FRONT_FACE | DYNAMIC_STATE_TOPOLOGY | DYNAMIC_STATE_DEPTH;
+    if(support.state2)
+        mask |= DYNAMIC_STATE_PRIMITIVE_RESTART;
+    if(support.polygonMode)
+        mask |= DYNAMIC_STATE_POLYGON_MODE;
+    if(support.colorBlendEnable)
+        mask |= DYNAMIC_STATE_BLEND_ENABLE;
+    if(support.colorWriteMask)
+        mask |= DYNAMIC_STATE_COLOR_WRITE_MASK;
+    return mask;
+}
+
+//the pipeline still needs a topology of the right class, the rest can be anything
+static VkPrimitiveTopology getTopologyClass(VkPrimitiveTopology topology) {
+    switch(topology) {
+        case VK_PRIMITIVE_TOPOLOGY_LINE_LIST:
+        case VK_PRIMITIVE_TOPOLOGY_LINE_STRIP:
+            return VK_PRIMITIVE_TOPOLOGY_LINE_LIST;
+        case VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST:
+        case VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP:
+            return VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+        default:
+            return topology;
+    }
+}
+
+PipelineKey PipelineKey::canonical() const {
+    PipelineKey key = *this;
+    PipelineKey defaults{};
+    if(dynamicState & DYNAMIC_STATE_CULL_MODE)
+        key.cullMode = defaults.cullMode;
+    if(dynamicState & DYNAMIC_STATE_FRONT_FACE)
+        key.frontFace = defaults.frontFace;
+    if(dynamicState & DYNAMIC_STATE_TOPOLOGY)
+        key.topology = getTopologyClass(topology);
+    if(dynamicState & DYNAMIC_STATE_DEPTH) {
+        key.depthTest = defaults.depthTest;
+        key.depthWrite = defaults.depthWrite;
+        key.depthCompareOp = defaults.depthCompareOp;
+    }
+    if(dynamicState & DYNAMIC_STATE_PRIMITIVE_RESTART)
+        key.primitiveRestart = defaults.primitiveRestart;
+    if(dynamicState & DYNAMIC_STATE_POLYGON_MODE)
+        key.polygonMode = defaults.polygonMode;
+    //the blend factors are still baked in, so blending stays enabled in the pipeline
+    if(dynamicState & DYNAMIC_STATE_BLEND_ENABLE)
+        key.blendEnable = true;
+    if(dynamicState & DYNAMIC_STATE_COLOR_WRITE_MASK)
+        key.colorWriteMask = defaults.colorWriteMask;
+    return key;
+}
+
+size_t PipelineKey::hash() const {
+    size_t seed = 0;
+    for(const auto& shaderFile : shaderFiles) {
+        hashCombine(seed, std::hash<std::string>()(shaderFile));
+    }
+    for(const auto& constant : specialization) {
+        hashCombine(seed, constant.stages);
+        hashCombine(seed, constant.constantID);
+        hashCombine(seed, constant.value);
+    }
+    for(const auto& binding : vertexBindings) {
+        hashCombine(seed, binding.binding);
+        hashCombine(seed, binding.stride);
+        hashCombine(seed, binding.inputRate);
+    }
+    for(const auto& attribute : vertexAttributes) {
+        hashCombine(seed, attribute.location);
+        hashCombine(seed, attribute.binding);
+        hashCombine(seed, attribute.format);
+        hashCombine(seed, attribute.offset);
+    }
+    hashCombine(seed, topology);
+    hashCombine(seed, primitiveRestart);
+    hashCombine(seed, polygonMode);
+    hashCombine(seed, cullMode);
+    hashCombine(seed, frontFace);
+    hashCombine(seed, samples);
+    hashCombine(seed, depthTest);
+    hashCombine(seed, depthWrite);
+    hashCombine(seed, depthCompareOp);
+    hashCombine(seed, blendEnable);
+    //blend factors don't matter with blending off, leave them out so they can't split otherwise equal keys
+    if(blendEnable) {
+        hashCombine(seed, srcColorBlendFactor);
+        hashCombine(seed, dstColorBlendFactor);
+        hashCombine(seed, colorBlendOp);
+        hashCombine(seed, srcAlphaBlendFactor);
+        hashCombine(seed, dstAlphaBlendFactor);
+        hashCombine(seed, alphaBlendOp);
+    }
+    hashCombine(seed, colorWriteMask);
+    hashCombine(seed, renderPass);
+    hashCombine(seed, subpass);
+    for(const auto& format : colorFormats) {
+        hashCombine(seed, format);
+    }
+    hashCombine(seed, depthFormat);
+    hashCombine(seed, layout);
+    hashCombine(seed, dynamicState);
+    return seed;
+}
+
+bool PipelineKey::operator==(const PipelineKey& other) const {
+    if(shaderFiles != other.shaderFiles)
+        return false;
+
+    if(specialization.size() != other.specialization.size())
+        return false;
+    for(size_t i = 0; i < specialization.size(); i++) {
+        const SpecializationConstant& a = specialization[i];
+        const SpecializationConstant& b = other.specialization[i];
+        if(a.stages != b.stages || a.constantID != b.constantID || a.value != b.value)
+            return false;
+    }
+
+    if(vertexBindings.size() != other.vertexBindings.size() || vertexAttributes.size() != other.vertexAttributes.size())
+        return false;
+    for(size_t i = 0; i < vertexBindings.size(); i++) {
+        const VkVertexInputBindingDescription& a = vertexBindings[i];
+        const VkVertexInputBindingDescription& b = other.vertexBindings[i];
+        if(a.binding != b.binding || a.stride != b.stride || a.inputRate != b.inputRate)
+            return false;
+    }
+    for(size_t i = 0; i < vertexAttributes.size(); i++) {
+        const VkVertexInputAttributeDescription& a = vertexAttributes[i];
+        const VkVertexInputAttributeDescription& b = other.vertexAttributes[i];
+        if(a.location != b.location || a.binding != b.binding || a.format != b.format || a.offset != b.offset)
+            return false;
+    }
+
+    if(blendEnable != other.blendEnable)
+        return false;
+    if(blendEnable && (srcColorBlendFactor != other.srcColorBlendFactor || dstColorBlendFactor != other.dstColorBlendFactor ||
+        colorBlendOp != other.colorBlendOp || srcAlphaBlendFactor != other.srcAlphaBlendFactor ||
+        dstAlphaBlendFactor != other.dstAlphaBlendFactor || alphaBlendOp != other.alphaBlendOp))
+        return false;
+
+    return topology == other.topology &&
+        primitiveRestart == other.primitiveRestart &&
+        polygonMode == other.polygonMode &&
+        cullMode == other.cullMode &&
+        frontFace == other.frontFace &&
+        samples == other.samples &&
+        depthTest == other.depthTest &&
+        depthWrite == other.depthWrite &&
+        depthCompareOp == other.depthCompareOp &&
+        colorWriteMask == other.colorWriteMask &&
+        renderPass == other.renderPass &&
+        subpass == other.subpass &&
+        colorFormats == other.colorFormats &&
+        depthFormat == other.depthFormat &&
+        layout == other.layout &&
+        dynamicState == other.dynamicState;
+}
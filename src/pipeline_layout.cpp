@@ -0,0 +1,85 @@
+#include "bindless_table.h"
+#include "layout_cache.h"
+#include "shader.h"
+#include "shader_library.h"
+#include "shader_reflection.h"
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <pipeline_layout.h>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <vulkan/vulkan_core.h>
+
+PipelineLayout::PipelineLayout(Device* device, const std::vector<std::string>& shaderFiles, bool dynamicUniforms, uint32_t firstInstanceLocation) {
+    std::vector<ShaderReflection> stages;
+    stages.reserve(shaderFiles.size());
+    for(const auto& shaderFile : shaderFiles) {
+        stages.push_back(device->getShaderLibrary()->load(shaderFile)->getReflection());
+    }
+    reflection = mergeReflections(stages);
+    if(firstInstanceLocation != NO_INSTANCE_INPUTS)
+        splitInstanceInputs(reflection, firstInstanceLocation);
+    //spir-v doesn't tell static and dynamic uniform buffers apart, that's up to how the data is bound
+    if(dynamicUniforms) {
+        for(auto& set : reflection.sets) {
+            for(auto& binding : set.second) {
+                if(binding.descriptorType == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER)
+                    binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+            }
+        }
+    }
+    createLayouts(device);
+}
+
+PipelineLayout::PipelineLayout(Device* device, const std::vector<VkDescriptorSetLayoutBinding>& bindings) {
+    reflection.sets[0] = bindings;
+    createLayouts(device);
+}
+
+void PipelineLayout::createLayouts(Device* device) {
+    //set numbers can skip, the gaps still need a layout in the pipeline layout so they get an empty one
+    uint32_t setCount = reflection.sets.empty() ? 0 : reflection.sets.rbegin()->first + 1;
+    for(uint32_t set = 0; set < setCount; set++) {
+        if(set == BINDLESS_SET && !reflection.sets[set].empty()) {
+            setLayouts.push_back(getBindlessLayout(device));
+            continue;
+        }
+        setLayouts.push_back(device->getLayoutCache()->getSetLayout(reflection.sets[set]));
+    }
+    layout = device->getLayoutCache()->getPipelineLayout(setLayouts, reflection.pushConstantRanges);
+}
+
+//the bindless set is owned by the device's table, the shader only has to declare bindings the table has.
+//runtime arrays reflect with a count of 1, so the count isn't compared
+VkDescriptorSetLayout PipelineLayout::getBindlessLayout(Device* device) {
+    BindlessTable* table = device->getBindlessTable();
+    std::vector<VkDescriptorSetLayoutBinding> tableBindings = table->getBindings();
+    for(const auto& binding : reflection.sets[BINDLESS_SET]) {
+        auto it = std::find_if(tableBindings.begin(), tableBindings.end(), [&binding](const VkDescriptorSetLayoutBinding& b) { return b.binding == binding.binding; });
+        if(it == tableBindings.end() || it->descriptorType != binding.descriptorType) {
+            throw std::runtime_error("SHADER BINDLESS SET DOES NOT MATCH THE BINDLESS TABLE");
+        }
+    }
+    return table->getSetLayout();
+}
+
+//turns name -> value into what a PipelineKey needs. sorted by id so the same permutation always makes an equal key,
+//and constants left at their default are dropped so they don't split the cache either
+std::vector<SpecializationConstant> PipelineLayout::resolveSpecialization(const std::map<std::string, uint32_t>& values) {
+    std::vector<SpecializationConstant> resolved;
+    for(const auto& value : values) {
+        auto it = reflection.specializationConstants.find(value.first);
+        if(it == reflection.specializationConstants.end()) {
+            throw std::runtime_error("SHADERS HAVE NO SPECIALIZATION CONSTANT NAMED " + value.first);
+        }
+        if(it->second.value == value.second)
+            continue;
+        SpecializationConstant constant = it->second;
+        constant.value = value.second;
+        resolved.push_back(constant);
+    }
+    std::sort(resolved.begin(), resolved.end(), [](const SpecializationConstant& a, const SpecializationConstant& b) { return a.constantID < b.constantID; });
+    return resolved;
+}
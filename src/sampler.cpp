@@ -1,3 +1,5 @@
+#include "descriptor_cache.h"
+#include <cstdint>
 #include <sampler.h>
 #include <stdexcept>
 
@@ -12,11 +14,8 @@ Sampler::Sampler(Device* device, VkFilter filter, VkSamplerAddressMode repeat) :
     samplerInfo.addressModeV = repeat;
     samplerInfo.addressModeW = repeat;
 
-    VkPhysicalDeviceProperties deviceProps{};
-    vkGetPhysicalDeviceProperties(device->getPhysicalDevices(), &deviceProps);
-
     samplerInfo.anisotropyEnable = VK_TRUE;
-    samplerInfo.maxAnisotropy = deviceProps.limits.maxSamplerAnisotropy;
+    samplerInfo.maxAnisotropy = device->getProperties().limits.maxSamplerAnisotropy;
 
     samplerInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
     samplerInfo.unnormalizedCoordinates = VK_FALSE;
@@ -35,5 +34,8 @@ Sampler::Sampler(Device* device, VkFilter filter, VkSamplerAddressMode repeat) :
 }
 
 Sampler::~Sampler() {
+    //cached descriptor sets pointing at this can't be handed out again
+    if(device->getDescriptorCache() != nullptr)
+        device->getDescriptorCache()->evict(reinterpret_cast<uint64_t>(sampler));
     vkDestroySampler(device->getDevice(), sampler, nullptr);
 }
\ No newline at end of file
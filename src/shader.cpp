@@ -1,36 +1,18 @@
-#include <fstream>
-#include <ios>
-#include <iostream>
+#include "shader_reflection.h"
+#include <cstddef>
+#include <cstdint>
 #include <shader.h>
 #include <stdexcept>
-#include <vector>
 #include <vulkan/vulkan_core.h>
 
-static std::vector<char> readFile(const std::string& filename) {
-    std::ifstream file(filename, std::ios::ate | std::ios::binary);
-
-    if(!file.is_open()) {
-        throw std::runtime_error("FAILED TO OPEN " + filename);
-    }
-
-    size_t fileSize = (size_t) file.tellg();
-    std::vector<char> buffer(fileSize);
-
-    file.seekg(0);
-    file.read(buffer.data(), fileSize);
-
-    file.close();
-    return buffer;
-}
-
-Shader::Shader(Device* device, const std::string& filename)
+Shader::Shader(Device* device, const uint32_t* code, size_t wordCount)
     : device(device) {
-    std::vector<char> data = readFile("shaders/" + filename);
+    reflection = reflectSpirv(code, wordCount);
     
     VkShaderModuleCreateInfo createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-    createInfo.codeSize = data.size();
-    createInfo.pCode = reinterpret_cast<const uint32_t*>(data.data());
+    createInfo.codeSize = wordCount * sizeof(uint32_t);
+    createInfo.pCode = code;
 
     if(vkCreateShaderModule(device->getDevice(), &createInfo, nullptr, &shaderModule) != VK_SUCCESS) {
         throw std::runtime_error("FAILED TO CREATE SHADER MODULE");
@@ -39,4 +21,4 @@ Shader::Shader(Device* device, const std::string& filename)
 
 Shader::~Shader() {
     vkDestroyShaderModule(device->getDevice(), shaderModule, nullptr);
-}
\ No newline at end of file
+}
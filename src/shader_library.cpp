@@ -0,0 +1,166 @@
+#include "device.h"
+#include "shader.h"
+#include <chrono>
+#include <cstring>
+#include <cstdint>
+#include <fcntl.h>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <shader_library.h>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+#include <vulkan/vulkan_core.h>
+
+//fnv-1a, fast enough to run over every file load and spreads spir-v words well
+static uint64_t hashSpirv(const uint8_t* data, size_t size) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for(size_t i = 0; i < size; i++) {
+        hash ^= data[i];
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+static bool sameFile(const struct stat& info, off_t size, const timespec& modified) {
+    return info.st_size == size && info.st_mtim.tv_sec == modified.tv_sec && info.st_mtim.tv_nsec == modified.tv_nsec;
+}
+
+//false when the file has changed since the module was made from it, its current contents say nothing about the module
+static bool sameCode(const std::string& path, off_t size, const timespec& modified, const void* data) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if(fd < 0)
+        return false;
+    struct stat info;
+    if(fstat(fd, &info) != 0 || !sameFile(info, size, modified)) {
+        close(fd);
+        return false;
+    }
+    void* mapped = mmap(nullptr, static_cast<size_t>(size), PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(mapped == MAP_FAILED)
+        return false;
+    bool same = memcmp(mapped, data, static_cast<size_t>(size)) == 0;
+    munmap(mapped, static_cast<size_t>(size));
+    return same;
+}
+
+ShaderLibrary::ShaderLibrary(Device* device) :
+    device(device) {}
+
+ShaderLibrary::~ShaderLibrary() {
+    printStats();
+    files.clear();
+    modules.clear();
+}
+
+std::shared_ptr<Shader> ShaderLibrary::load(const std::string& filename) {
+    auto start = std::chrono::high_resolution_clock::now();
+    std::string path = "shaders/" + filename;
+    std::lock_guard<std::mutex> lock(mutex);
+    stats.requests++;
+
+    int fd = open(path.c_str(), O_RDONLY);
+    if(fd < 0) {
+        throw std::runtime_error("FAILED TO OPEN " + filename);
+    }
+    struct stat info;
+    if(fstat(fd, &info) != 0) {
+        close(fd);
+        throw std::runtime_error("FAILED TO STAT " + filename);
+    }
+
+    //unchanged since the last load, skip reading it
+    auto file = files.find(path);
+    if(file != files.end() && sameFile(info, file->second.size, file->second.modified)) {
+        close(fd);
+        stats.fileHits++;
+        stats.loadMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        return file->second.shader;
+    }
+
+    size_t size = static_cast<size_t>(info.st_size);
+    if(size == 0 || size % sizeof(uint32_t) != 0) {
+        close(fd);
+        throw std::runtime_error("SPIR-V FILE SIZE IS NOT A MULTIPLE OF 4: " + filename);
+    }
+
+    //mappings are page aligned, so the words can go straight to vulkan without a copy
+    void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(mapped == MAP_FAILED) {
+        throw std::runtime_error("FAILED TO MAP " + filename);
+    }
+    stats.bytesMapped += size;
+
+    uint64_t hash = hashSpirv(static_cast<const uint8_t*>(mapped), size);
+
+    //a hash match alone could be a collision, the code has to be the same too
+    std::shared_ptr<Shader> shader;
+    std::vector<ModuleEntry>& bucket = modules[hash];
+    for(const auto& entry : bucket) {
+        if(static_cast<size_t>(entry.size) == size && sameCode(entry.path, entry.size, entry.modified, mapped)) {
+            shader = entry.shader;
+            break;
+        }
+    }
+    if(shader) {
+        stats.contentHits++;
+    } else {
+        try {
+            const uint32_t* code = static_cast<const uint32_t*>(mapped);
+            shader = std::make_shared<Shader>(device, code, size / sizeof(uint32_t));
+            bucket.push_back(ModuleEntry{path, info.st_size, info.st_mtim, shader});
+        } catch(...) {
+            if(bucket.empty())
+                modules.erase(hash);
+            munmap(mapped, size);
+            throw;
+        }
+        stats.modulesCreated++;
+    }
+    munmap(mapped, size);
+
+    if(file != files.end() && file->second.shader != shader)
+        dropModule(path, file->second.hash, file->second.shader);
+    files[path] = FileEntry{hash, info.st_size, info.st_mtim, shader};
+
+    stats.loadMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    return shader;
+}
+
+//a file was rebuilt with new contents, its old module goes once no other file has the same code.
+//pipelines only need modules while they are created, so nothing else is holding on to it
+void ShaderLibrary::dropModule(const std::string& path, uint64_t hash, const std::shared_ptr<Shader>& shader) {
+    for(const auto& file : files) {
+        if(file.first != path && file.second.shader == shader)
+            return;
+    }
+    auto bucket = modules.find(hash);
+    if(bucket == modules.end())
+        return;
+    for(auto it = bucket->second.begin(); it != bucket->second.end(); it++) {
+        if(it->shader == shader) {
+            bucket->second.erase(it);
+            break;
+        }
+    }
+    if(bucket->second.empty())
+        modules.erase(bucket);
+}
+
+ShaderLibraryStats ShaderLibrary::getStats() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats;
+}
+
+void ShaderLibrary::printStats() {
+    ShaderLibraryStats current = getStats();
+    std::cout << "Shader library: " << current.requests << " loads, " << current.fileHits << " unchanged file hits, "
+        << current.contentHits << " content hits, " << current.modulesCreated << " modules created, "
+        << current.bytesMapped << " bytes mapped in " << current.loadMilliseconds << "ms" << std::endl;
+}
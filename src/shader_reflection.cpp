@@ -0,0 +1,466 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <shader_reflection.h>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <vulkan/vulkan_core.h>
+
+//the handful of spir-v opcodes and enums the reflector needs, values from the spir-v specification
+const uint32_t SPIRV_MAGIC = 0x07230203;
+const uint32_t SPIRV_HEADER_WORDS = 5;
+
+enum SpirvOp : uint32_t {
+    OP_NAME = 5,
+    OP_ENTRY_POINT = 15,
+    OP_TYPE_BOOL = 20,
+    OP_TYPE_INT = 21,
+    OP_TYPE_FLOAT = 22,
+    OP_TYPE_VECTOR = 23,
+    OP_TYPE_MATRIX = 24,
+    OP_TYPE_IMAGE = 25,
+    OP_TYPE_SAMPLER = 26,
+    OP_TYPE_SAMPLED_IMAGE = 27,
+    OP_TYPE_ARRAY = 28,
+    OP_TYPE_RUNTIME_ARRAY = 29,
+    OP_TYPE_STRUCT = 30,
+    OP_TYPE_POINTER = 32,
+    OP_CONSTANT = 43,
+    OP_SPEC_CONSTANT_TRUE = 48,
+    OP_SPEC_CONSTANT_FALSE = 49,
+    OP_SPEC_CONSTANT = 50,
+    OP_VARIABLE = 59,
+    OP_DECORATE = 71,
+    OP_MEMBER_DECORATE = 72
+};
+
+enum SpirvDecoration : uint32_t {
+    DECORATION_SPEC_ID = 1,
+    DECORATION_BLOCK = 2,
+    DECORATION_BUFFER_BLOCK = 3,
+    DECORATION_ARRAY_STRIDE = 6,
+    DECORATION_MATRIX_STRIDE = 7,
+    DECORATION_BUILT_IN = 11,
+    DECORATION_LOCATION = 30,
+    DECORATION_BINDING = 33,
+    DECORATION_DESCRIPTOR_SET = 34,
+    DECORATION_OFFSET = 35
+};
+
+enum SpirvStorageClass : uint32_t {
+    STORAGE_UNIFORM_CONSTANT = 0,
+    STORAGE_INPUT = 1,
+    STORAGE_UNIFORM = 2,
+    STORAGE_PUSH_CONSTANT = 9,
+    STORAGE_STORAGE_BUFFER = 12
+};
+
+const uint32_t IMAGE_DIM_BUFFER = 5;
+const uint32_t IMAGE_DIM_SUBPASS_DATA = 6;
+
+struct SpirvDecorations {
+    bool hasSet = false;
+    bool hasBinding = false;
+    bool hasLocation = false;
+    bool hasSpecId = false;
+    bool builtIn = false;
+    bool bufferBlock = false;
+    uint32_t set = 0;
+    uint32_t binding = 0;
+    uint32_t location = 0;
+    uint32_t specId = 0;
+    uint32_t arrayStride = 0;
+};
+
+struct SpirvMember {
+    uint32_t offset = 0;
+    uint32_t matrixStride = 0;
+};
+
+struct SpirvModule {
+    std::unordered_map<uint32_t, std::vector<uint32_t>> types; // id -> opcode followed by the instruction's operands
+    std::unordered_map<uint32_t, uint32_t> constants;
+    std::unordered_map<uint32_t, SpirvDecorations> decorations;
+    std::unordered_map<uint32_t, std::vector<SpirvMember>> members;
+    std::unordered_map<uint32_t, std::string> names;
+};
+
+static VkShaderStageFlagBits getStageFromExecutionModel(uint32_t model) {
+    switch(model) {
+        case 0: return VK_SHADER_STAGE_VERTEX_BIT;
+        case 1: return VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT;
+        case 2: return VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT;
+        case 3: return VK_SHADER_STAGE_GEOMETRY_BIT;
+        case 4: return VK_SHADER_STAGE_FRAGMENT_BIT;
+        case 5: return VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+    throw std::runtime_error("UNSUPPORTED SPIR-V EXECUTION MODEL");
+}
+
+static const std::vector<uint32_t>& getType(const SpirvModule& module, uint32_t id) {
+    auto it = module.types.find(id);
+    if(it == module.types.end()) {
+        throw std::runtime_error("SPIR-V REFERENCES UNKNOWN TYPE");
+    }
+    return it->second;
+}
+
+//size of a type as laid out in a block, uses the offsets and strides the compiler decorated it with
+static uint32_t getTypeSize(const SpirvModule& module, uint32_t id, uint32_t matrixStride = 0) {
+    const std::vector<uint32_t>& type = getType(module, id);
+    switch(type[0]) {
+        case OP_TYPE_BOOL:
+            return 4;
+        case OP_TYPE_INT:
+        case OP_TYPE_FLOAT:
+            return type[1] / 8;
+        case OP_TYPE_VECTOR:
+            return type[2] * getTypeSize(module, type[1]);
+        case OP_TYPE_MATRIX:
+            return type[2] * (matrixStride != 0 ? matrixStride : getTypeSize(module, type[1]));
+        case OP_TYPE_ARRAY: {
+            auto deco = module.decorations.find(id);
+            uint32_t stride = deco != module.decorations.end() && deco->second.arrayStride != 0 ? deco->second.arrayStride : getTypeSize(module, type[1]);
+            return stride * module.constants.at(type[2]);
+        }
+        case OP_TYPE_STRUCT: {
+            auto memberDecorations = module.members.find(id);
+            uint32_t size = 0;
+            for(size_t i = 1; i < type.size(); i++) {
+                SpirvMember member{};
+                if(memberDecorations != module.members.end() && i - 1 < memberDecorations->second.size())
+                    member = memberDecorations->second[i - 1];
+                size = std::max(size, member.offset + getTypeSize(module, type[i], member.matrixStride));
+            }
+            return size;
+        }
+    }
+    throw std::runtime_error("UNSUPPORTED SPIR-V TYPE IN BLOCK");
+}
+
+static VkFormat getVertexFormat(const SpirvModule& module, uint32_t id, uint32_t& size) {
+    const std::vector<uint32_t>& type = getType(module, id);
+    uint32_t components = 1;
+    const std::vector<uint32_t>* scalar = &type;
+    if(type[0] == OP_TYPE_VECTOR) {
+        components = type[2];
+        scalar = &getType(module, type[1]);
+    }
+    if(((*scalar)[0] != OP_TYPE_FLOAT && (*scalar)[0] != OP_TYPE_INT) || (*scalar)[1] != 32 || components > 4) {
+        throw std::runtime_error("UNSUPPORTED VERTEX INPUT TYPE");
+    }
+    size = components * 4;
+
+    static const VkFormat floatFormats[] = {VK_FORMAT_R32_SFLOAT, VK_FORMAT_R32G32_SFLOAT, VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R32G32B32A32_SFLOAT};
+    static const VkFormat intFormats[] = {VK_FORMAT_R32_SINT, VK_FORMAT_R32G32_SINT, VK_FORMAT_R32G32B32_SINT, VK_FORMAT_R32G32B32A32_SINT};
+    static const VkFormat uintFormats[] = {VK_FORMAT_R32_UINT, VK_FORMAT_R32G32_UINT, VK_FORMAT_R32G32B32_UINT, VK_FORMAT_R32G32B32A32_UINT};
+    if((*scalar)[0] == OP_TYPE_FLOAT)
+        return floatFormats[components - 1];
+    return (*scalar)[2] ? intFormats[components - 1] : uintFormats[components - 1];
+}
+
+static VkDescriptorType getDescriptorType(const SpirvModule& module, uint32_t storageClass, uint32_t id) {
+    const std::vector<uint32_t>& type = getType(module, id);
+    if(storageClass == STORAGE_STORAGE_BUFFER)
+        return VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    if(storageClass == STORAGE_UNIFORM) {
+        //old style storage buffers are uniform blocks decorated BufferBlock
+        auto deco = module.decorations.find(id);
+        bool bufferBlock = deco != module.decorations.end() && deco->second.bufferBlock;
+        return bufferBlock ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    }
+
+    switch(type[0]) {
+        case OP_TYPE_SAMPLER:
+            return VK_DESCRIPTOR_TYPE_SAMPLER;
+        case OP_TYPE_SAMPLED_IMAGE:
+            return VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        case OP_TYPE_IMAGE: {
+            //operands are sampled type, dim, depth, arrayed, ms, sampled. sampled == 2 means storage
+            bool storage = type[6] == 2;
+            if(type[2] == IMAGE_DIM_BUFFER)
+                return storage ? VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+            if(type[2] == IMAGE_DIM_SUBPASS_DATA)
+                return VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+            return storage ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+        }
+    }
+    throw std::runtime_error("UNSUPPORTED SPIR-V DESCRIPTOR TYPE");
+}
+
+ShaderReflection reflectSpirv(const uint32_t* code, size_t wordCount) {
+    if(wordCount < SPIRV_HEADER_WORDS || code[0] != SPIRV_MAGIC) {
+        throw std::runtime_error("INVALID SPIR-V MODULE");
+    }
+
+    SpirvModule module;
+    ShaderReflection reflection;
+    bool foundEntryPoint = false;
+    struct Variable {
+        uint32_t id;
+        uint32_t pointerType;
+        uint32_t storageClass;
+    };
+    std::vector<Variable> variables;
+    std::map<uint32_t, uint32_t> specConstants; // result id -> default value
+
+    //one pass to collect types, decorations and variables, they can reference each other in any order
+    size_t offset = SPIRV_HEADER_WORDS;
+    while(offset < wordCount) {
+        uint32_t opcode = code[offset] & 0xffff;
+        uint32_t count = code[offset] >> 16;
+        if(count == 0 || offset + count > wordCount) {
+            throw std::runtime_error("INVALID SPIR-V MODULE");
+        }
+        const uint32_t* operands = code + offset + 1;
+
+        switch(opcode) {
+            case OP_ENTRY_POINT:
+                if(!foundEntryPoint) {
+                    reflection.stage = getStageFromExecutionModel(operands[0]);
+                    foundEntryPoint = true;
+                }
+                break;
+            case OP_TYPE_BOOL:
+            case OP_TYPE_INT:
+            case OP_TYPE_FLOAT:
+            case OP_TYPE_VECTOR:
+            case OP_TYPE_MATRIX:
+            case OP_TYPE_IMAGE:
+            case OP_TYPE_SAMPLER:
+            case OP_TYPE_SAMPLED_IMAGE:
+            case OP_TYPE_ARRAY:
+            case OP_TYPE_RUNTIME_ARRAY:
+            case OP_TYPE_STRUCT:
+            case OP_TYPE_POINTER: {
+                std::vector<uint32_t> type = {opcode};
+                type.insert(type.end(), operands + 1, operands + count - 1);
+                module.types[operands[0]] = type;
+                break;
+            }
+            case OP_NAME: {
+                //nul terminated utf-8 packed into the following words
+                const char* name = reinterpret_cast<const char*>(operands + 1);
+                size_t maxLength = (count - 2) * sizeof(uint32_t);
+                module.names[operands[0]] = std::string(name, strnlen(name, maxLength));
+                break;
+            }
+            case OP_CONSTANT:
+                module.constants[operands[1]] = operands[2];
+                break;
+            case OP_SPEC_CONSTANT_TRUE:
+                specConstants[operands[1]] = 1;
+                break;
+            case OP_SPEC_CONSTANT_FALSE:
+                specConstants[operands[1]] = 0;
+                break;
+            case OP_SPEC_CONSTANT:
+                specConstants[operands[1]] = operands[2];
+                //array sizes can be spec constants, use the default for sizing
+                module.constants[operands[1]] = operands[2];
+                break;
+            case OP_VARIABLE:
+                variables.push_back(Variable{operands[1], operands[0], operands[2]});
+                break;
+            case OP_DECORATE: {
+                SpirvDecorations& deco = module.decorations[operands[0]];
+                switch(operands[1]) {
+                    case DECORATION_BUFFER_BLOCK: deco.bufferBlock = true; break;
+                    case DECORATION_SPEC_ID: deco.hasSpecId = true; deco.specId = operands[2]; break;
+                    case DECORATION_ARRAY_STRIDE: deco.arrayStride = operands[2]; break;
+                    case DECORATION_BUILT_IN: deco.builtIn = true; break;
+                    case DECORATION_LOCATION: deco.hasLocation = true; deco.location = operands[2]; break;
+                    case DECORATION_BINDING: deco.hasBinding = true; deco.binding = operands[2]; break;
+                    case DECORATION_DESCRIPTOR_SET: deco.hasSet = true; deco.set = operands[2]; break;
+                }
+                break;
+            }
+            case OP_MEMBER_DECORATE: {
+                std::vector<SpirvMember>& members = module.members[operands[0]];
+                if(members.size() <= operands[1])
+                    members.resize(operands[1] + 1);
+                if(operands[2] == DECORATION_OFFSET)
+                    members[operands[1]].offset = operands[3];
+                else if(operands[2] == DECORATION_MATRIX_STRIDE)
+                    members[operands[1]].matrixStride = operands[3];
+                break;
+            }
+        }
+        offset += count;
+    }
+
+    if(!foundEntryPoint) {
+        throw std::runtime_error("SPIR-V MODULE HAS NO ENTRY POINT");
+    }
+
+    //constants without a name are still reachable by their id, written as a decimal string
+    for(const auto& constant : specConstants) {
+        auto deco = module.decorations.find(constant.first);
+        if(deco == module.decorations.end() || !deco->second.hasSpecId)
+            continue;
+        auto name = module.names.find(constant.first);
+        std::string key = name != module.names.end() && !name->second.empty() ? name->second : std::to_string(deco->second.specId);
+        reflection.specializationConstants[key] = SpecializationConstant{static_cast<VkShaderStageFlags>(reflection.stage), deco->second.specId, constant.second};
+    }
+
+    for(const auto& variable : variables) {
+        uint32_t typeId = getType(module, variable.pointerType)[2];
+        auto deco = module.decorations.find(variable.id);
+        SpirvDecorations decorations = deco != module.decorations.end() ? deco->second : SpirvDecorations{};
+
+        if(variable.storageClass == STORAGE_PUSH_CONSTANT) {
+            reflection.pushConstantSize = std::max(reflection.pushConstantSize, getTypeSize(module, typeId));
+            continue;
+        }
+
+        if(variable.storageClass == STORAGE_INPUT) {
+            if(reflection.stage != VK_SHADER_STAGE_VERTEX_BIT || decorations.builtIn || !decorations.hasLocation)
+                continue;
+            //a matrix takes one location per column
+            uint32_t columns = 1;
+            const std::vector<uint32_t>& type = getType(module, typeId);
+            if(type[0] == OP_TYPE_MATRIX) {
+                columns = type[2];
+                typeId = type[1];
+            }
+            for(uint32_t column = 0; column < columns; column++) {
+                VkVertexInputAttributeDescription attribute{};
+                uint32_t size = 0;
+                attribute.location = decorations.location + column;
+                attribute.format = getVertexFormat(module, typeId, size);
+                reflection.vertexInputs.push_back(attribute);
+                reflection.vertexInputSizes.push_back(size);
+            }
+            continue;
+        }
+
+        if(variable.storageClass != STORAGE_UNIFORM_CONSTANT && variable.storageClass != STORAGE_UNIFORM && variable.storageClass != STORAGE_STORAGE_BUFFER)
+            continue;
+        if(!decorations.hasBinding)
+            continue;
+
+        //arrays of descriptors become one binding with a count, runtime sized ones get a single slot for now
+        uint32_t descriptorCount = 1;
+        const std::vector<uint32_t>* type = &getType(module, typeId);
+        while((*type)[0] == OP_TYPE_ARRAY || (*type)[0] == OP_TYPE_RUNTIME_ARRAY) {
+            if((*type)[0] == OP_TYPE_ARRAY)
+                descriptorCount *= module.constants.at((*type)[2]);
+            typeId = (*type)[1];
+            type = &getType(module, typeId);
+        }
+
+        ReflectedBinding binding{};
+        binding.set = decorations.set;
+        binding.binding.binding = decorations.binding;
+        binding.binding.descriptorType = getDescriptorType(module, variable.storageClass, typeId);
+        binding.binding.descriptorCount = descriptorCount;
+        binding.binding.stageFlags = reflection.stage;
+        binding.binding.pImmutableSamplers = nullptr;
+        reflection.bindings.push_back(binding);
+    }
+
+    return reflection;
+}
+
+PipelineReflection mergeReflections(const std::vector<ShaderReflection>& stages) {
+    PipelineReflection merged;
+
+    for(const auto& stage : stages) {
+        for(const auto& reflected : stage.bindings) {
+            std::vector<VkDescriptorSetLayoutBinding>& set = merged.sets[reflected.set];
+            auto it = std::find_if(set.begin(), set.end(), [&reflected](const VkDescriptorSetLayoutBinding& b) { return b.binding == reflected.binding.binding; });
+            if(it == set.end()) {
+                set.push_back(reflected.binding);
+                continue;
+            }
+            if(it->descriptorType != reflected.binding.descriptorType || it->descriptorCount != reflected.binding.descriptorCount) {
+                throw std::runtime_error("SHADER STAGES DISAGREE ON DESCRIPTOR BINDING");
+            }
+            it->stageFlags |= reflected.binding.stageFlags;
+        }
+
+        //every stage's block starts at offset 0, so stages with the same size share one range
+        if(stage.pushConstantSize > 0) {
+            auto it = std::find_if(merged.pushConstantRanges.begin(), merged.pushConstantRanges.end(),
+                [&stage](const VkPushConstantRange& r) { return r.size == stage.pushConstantSize; });
+            if(it != merged.pushConstantRanges.end()) {
+                it->stageFlags |= stage.stage;
+            } else {
+                merged.pushConstantRanges.push_back(VkPushConstantRange{static_cast<VkShaderStageFlags>(stage.stage), 0, stage.pushConstantSize});
+            }
+        }
+
+        for(const auto& constant : stage.specializationConstants) {
+            auto it = merged.specializationConstants.find(constant.first);
+            if(it == merged.specializationConstants.end()) {
+                merged.specializationConstants[constant.first] = constant.second;
+                continue;
+            }
+            if(it->second.constantID != constant.second.constantID) {
+                throw std::runtime_error("SHADER STAGES USE DIFFERENT IDS FOR SPECIALIZATION CONSTANT " + constant.first);
+            }
+            it->second.stages |= constant.second.stages;
+        }
+
+        if(stage.stage != VK_SHADER_STAGE_VERTEX_BIT || stage.vertexInputs.empty())
+            continue;
+
+        std::vector<size_t> order(stage.vertexInputs.size());
+        for(size_t i = 0; i < order.size(); i++) {
+            order[i] = i;
+        }
+        std::sort(order.begin(), order.end(), [&stage](size_t a, size_t b) { return stage.vertexInputs[a].location < stage.vertexInputs[b].location; });
+
+        uint32_t stride = 0;
+        for(size_t index : order) {
+            VkVertexInputAttributeDescription attribute = stage.vertexInputs[index];
+            attribute.binding = 0;
+            attribute.offset = stride;
+            stride += stage.vertexInputSizes[index];
+            merged.vertexAttributes.push_back(attribute);
+        }
+
+        VkVertexInputBindingDescription binding{};
+        binding.binding = 0;
+        binding.stride = stride;
+        binding.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+        merged.vertexBindings.push_back(binding);
+    }
+
+    for(auto& set : merged.sets) {
+        std::sort(set.second.begin(), set.second.end(), [](const VkDescriptorSetLayoutBinding& a, const VkDescriptorSetLayoutBinding& b) { return a.binding < b.binding; });
+    }
+
+    return merged;
+}
+
+//locations from firstLocation up move to binding 1, read once per instance. both bindings stay tightly packed
+void splitInstanceInputs(PipelineReflection& reflection, uint32_t firstLocation) {
+    if(reflection.vertexBindings.empty())
+        return;
+
+    uint32_t instanceOffset = reflection.vertexBindings[0].stride;
+    for(const auto& attribute : reflection.vertexAttributes) {
+        if(attribute.location >= firstLocation)
+            instanceOffset = std::min(instanceOffset, attribute.offset);
+    }
+    if(instanceOffset == reflection.vertexBindings[0].stride)
+        return;
+
+    VkVertexInputBindingDescription instanceBinding{};
+    instanceBinding.binding = 1;
+    instanceBinding.stride = reflection.vertexBindings[0].stride - instanceOffset;
+    instanceBinding.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+    reflection.vertexBindings[0].stride = instanceOffset;
+    reflection.vertexBindings.push_back(instanceBinding);
+
+    for(auto& attribute : reflection.vertexAttributes) {
+        if(attribute.location < firstLocation)
+            continue;
+        attribute.binding = 1;
+        attribute.offset -= instanceOffset;
+    }
+}
@@ -0,0 +1,102 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <poll.h>
+#include <set>
+#include <shader_watcher.h>
+#include <stdexcept>
+#include <string>
+#include <sys/inotify.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+static bool isShaderSource(const std::string& name) {
+    static const std::vector<std::string> extensions = {".vert", ".frag", ".comp", ".geom", ".tesc", ".tese"};
+    for(const auto& extension : extensions) {
+        if(name.size() > extension.size() && name.compare(name.size() - extension.size(), extension.size(), extension) == 0)
+            return true;
+    }
+    return false;
+}
+
+ShaderWatcher::ShaderWatcher(const std::string& sourceDir, const std::string& outputDir, const std::string& compiler) :
+    sourceDir(sourceDir), outputDir(outputDir), compiler(compiler) {
+    inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if(inotifyFd < 0) {
+        throw std::runtime_error("FAILED TO INITIALIZE INOTIFY");
+    }
+
+    //editors either write in place or write a temp file and rename it over the original
+    watchDescriptor = inotify_add_watch(inotifyFd, sourceDir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+    if(watchDescriptor < 0) {
+        close(inotifyFd);
+        throw std::runtime_error("FAILED TO WATCH SHADER DIRECTORY " + sourceDir);
+    }
+
+    thread = std::thread(&ShaderWatcher::watchLoop, this);
+    std::cout << "Watching " << sourceDir << " for shader changes, compiling with " << compiler << std::endl;
+}
+
+ShaderWatcher::~ShaderWatcher() {
+    stopping = true;
+    thread.join();
+    inotify_rm_watch(inotifyFd, watchDescriptor);
+    close(inotifyFd);
+}
+
+std::vector<std::string> ShaderWatcher::takeChanged() {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<std::string> result;
+    result.swap(changed);
+    return result;
+}
+
+void ShaderWatcher::watchLoop() {
+    alignas(inotify_event) char buffer[4096];
+    std::set<std::string> pending;
+
+    while(!stopping) {
+        //short timeout so shutdown doesn't hang, and so a burst of saves is compiled once
+        pollfd descriptor{inotifyFd, POLLIN, 0};
+        int ready = poll(&descriptor, 1, 50);
+        if(ready > 0) {
+            ssize_t length;
+            while((length = read(inotifyFd, buffer, sizeof(buffer))) > 0) {
+                for(char* ptr = buffer; ptr < buffer + length;) {
+                    inotify_event* event = reinterpret_cast<inotify_event*>(ptr);
+                    if(event->len > 0 && isShaderSource(event->name))
+                        pending.insert(event->name);
+                    ptr += sizeof(inotify_event) + event->len;
+                }
+            }
+            continue;
+        }
+
+        for(const auto& source : pending) {
+            if(!compile(source))
+                continue;
+            std::lock_guard<std::mutex> lock(mutex);
+            std::string output = source + ".spv";
+            if(std::find(changed.begin(), changed.end(), output) == changed.end())
+                changed.push_back(output);
+        }
+        pending.clear();
+    }
+}
+
+//glslc prints its own errors, a failed compile leaves the old .spv and the running pipeline alone
+bool ShaderWatcher::compile(const std::string& source) {
+    auto start = std::chrono::high_resolution_clock::now();
+    std::string command = "\"" + compiler + "\" \"" + sourceDir + "/" + source + "\" -o \"" + outputDir + "/" + source + ".spv\"";
+    int result = std::system(command.c_str());
+    double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    if(result != 0) {
+        std::cerr << "Failed to compile " << source << ", keeping the previous version" << std::endl;
+        return false;
+    }
+    std::cout << "Recompiled " << source << " in " << milliseconds << "ms" << std::endl;
+    return true;
+}
@@ -0,0 +1,129 @@
+#include "buffer.h"
+#include "timeline_semaphore.h"
+#include "memory_util.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <staging_ring.h>
+#include <vulkan/vulkan_core.h>
+
+static VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment) {
+    if(alignment <= 1)
+        return value;
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+StagingRing::StagingRing(Device* device, VkDeviceSize capacity) :
+    device(device), capacity(capacity),
+    buffer(device, capacity, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_SHARING_MODE_EXCLUSIVE, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, MEMORY_USAGE_UPLOAD) {
+    mapped = static_cast<char*>(buffer.mapBuffer());
+    createdTime = std::chrono::high_resolution_clock::now();
+}
+
+StagingRing::~StagingRing() {
+    for(auto& region : regions) {
+        region.point.wait();
+    }
+}
+
+void StagingRing::retireCompleted() {
+    while(!regions.empty() && regions.front().point.isReached()) {
+        usedBytes -= regions.front().bytes;
+        regions.pop_front();
+    }
+}
+
+void StagingRing::waitOldest() {
+    if(regions.empty()) {
+        throw std::runtime_error("STAGING RING FULL, SUBMIT PENDING UPLOADS BEFORE STAGING MORE DATA");
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+    regions.front().point.wait();
+    auto end = std::chrono::high_resolution_clock::now();
+
+    stats.stallCount++;
+    stats.stallMilliseconds += std::chrono::duration<double, std::milli>(end - start).count();
+    retireCompleted();
+}
+
+StagingSlice StagingRing::allocate(VkDeviceSize size, VkDeviceSize alignment) {
+    alignment = std::max(alignment, device->getProperties().limits.optimalBufferCopyOffsetAlignment);
+    if(size > capacity) {
+        throw std::runtime_error("STAGING UPLOAD LARGER THAN STAGING RING");
+    }
+
+    while(true) {
+        retireCompleted();
+        if(usedBytes == 0)
+            head = 0;
+
+        //live bytes are [tail, head) wrapping around the end of the buffer
+        VkDeviceSize tail = (head + capacity - usedBytes) % capacity;
+        VkDeviceSize offset = alignUp(head, alignment);
+        VkDeviceSize consumed = 0;
+        bool fits = false;
+
+        if(usedBytes < capacity && head >= tail) {
+            if(offset + size <= capacity) {
+                consumed = offset - head + size;
+                fits = true;
+            } else if(size <= tail) {
+                //skip the rest of the buffer and start again at the front
+                consumed = capacity - head + size;
+                offset = 0;
+                fits = true;
+            }
+        } else if(usedBytes < capacity && offset + size <= tail) {
+            consumed = offset - head + size;
+            fits = true;
+        }
+
+        if(!fits) {
+            waitOldest();
+            continue;
+        }
+
+        head = (offset + size) % capacity;
+        usedBytes += consumed;
+        openBytes += consumed;
+        stats.bytesStaged += size;
+        stats.sliceCount++;
+
+        StagingSlice slice{};
+        slice.buffer = &buffer;
+        slice.offset = offset;
+        slice.size = size;
+        slice.data = mapped + offset;
+        return slice;
+    }
+}
+
+StagingSlice StagingRing::stage(const void* data, VkDeviceSize size, VkDeviceSize alignment) {
+    StagingSlice slice = allocate(size, alignment);
+    memcpy(slice.data, data, static_cast<size_t>(size));
+    return slice;
+}
+
+//point is the timeline value signalled by the submission that reads the open slices
+void StagingRing::endBatch(TimelinePoint point) {
+    regions.push_back(Region{openBytes, point});
+    openBytes = 0;
+}
+
+StagingStats StagingRing::getStats() {
+    StagingStats result = stats;
+    double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - createdTime).count();
+    if(seconds > 0.0)
+        result.bytesPerSecond = static_cast<double>(stats.bytesStaged) / seconds;
+    return result;
+}
+
+void StagingRing::printStats() {
+    StagingStats current = getStats();
+    std::cout << "Staging: " << current.bytesStaged << " bytes in " << current.sliceCount << " slices, "
+        << current.bytesPerSecond / (1024.0 * 1024.0) << " MiB/s, " << current.stallCount << " stalls ("
+        << current.stallMilliseconds << "ms) waiting for ring space" << std::endl;
+}
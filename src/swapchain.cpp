@@ -1,9 +1,11 @@
 #include "device.h"
+#include "fence.h"
 #include "window.h"
 #include <algorithm>
 #include <cstdint>
 #include <iostream>
 #include <limits>
+#include <memory>
 #include <semaphore.h>
 #include <stdexcept>
 #include <swapchain.h>
@@ -20,16 +22,37 @@ VkSurfaceFormatKHR choseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>&
     return availableFormats[0];
 }
 
-VkPresentModeKHR choseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes) {
+const char* getPresentModeString(VkPresentModeKHR mode) {
+    switch(mode) {
+        case VK_PRESENT_MODE_IMMEDIATE_KHR: return "IMMEDIATE";
+        case VK_PRESENT_MODE_MAILBOX_KHR: return "MAILBOX";
+        case VK_PRESENT_MODE_FIFO_KHR: return "FIFO";
+        case VK_PRESENT_MODE_FIFO_RELAXED_KHR: return "FIFO_RELAXED";
+        default: return "UNKNOWN";
+    }
+}
+
+VkPresentModeKHR choseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes, VkPresentModeKHR preferred) {
     for (const auto& mode : availablePresentModes) {
-        if(mode == VK_PRESENT_MODE_MAILBOX_KHR) {
+        if(mode == preferred) {
             return mode;
         }
     }
 
+    //fifo is the only mode every surface has to support
+    std::cout << "Present mode " << getPresentModeString(preferred) << " not supported, falling back to FIFO" << std::endl;
     return VK_PRESENT_MODE_FIFO_KHR;
 }
 
+uint32_t choseSwapImageCount(const VkSurfaceCapabilitiesKHR& capabilities, uint32_t requested) {
+    uint32_t imageCount = requested != 0 ? requested : capabilities.minImageCount + 1;
+    imageCount = std::max(imageCount, capabilities.minImageCount);
+    if(capabilities.maxImageCount > 0 && imageCount > capabilities.maxImageCount) {
+        imageCount = capabilities.maxImageCount;
+    }
+    return imageCount;
+}
+
 VkExtent2D choseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities, Window* window) {
     if (capabilities.currentExtent.width != std::numeric_limits<uint32_t>::max()) {
         return capabilities.currentExtent;
@@ -54,8 +77,8 @@ VkExtent2D choseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities, Window*
     }
 }
 
-SwapChain::SwapChain(Device* device, Window* window, Surface* surface) :
-    device(device), window(window), surface(surface) {
+SwapChain::SwapChain(Device* device, Window* window, Surface* surface, const RenderConfig& config) :
+    device(device), window(window), surface(surface), config(config) {
     initSwapchain();
 }
 
@@ -63,34 +86,51 @@ SwapChain::~SwapChain() {
     deleteSwapchain();
 }
 
+//the old swapchain is handed to the new one and retired instead of destroyed, frames still in flight keep
+//rendering to and presenting its images. it and its views go once every present queued to it is done, see Device::deferPresentDestroy
 void SwapChain::recreateSwapchain() {
-    deleteSwapchain();
-    initSwapchain();
+    VkSwapchainKHR oldSwapchain = swapchain;
+    std::vector<ImageView*> oldViews;
+    for(auto& view : imageViews) {
+        oldViews.push_back(view.release());
+    }
+    imageViews.clear();
+    swapChainImages.clear();
+
+    initSwapchain(oldSwapchain);
+
+    Device* owner = device;
+    device->deferPresentDestroy([owner, oldSwapchain, oldViews]() {
+        for(auto view : oldViews) {
+            delete view;
+        }
+        vkDestroySwapchainKHR(owner->getDevice(), oldSwapchain, nullptr);
+    });
 }
 
 void SwapChain::deleteSwapchain() {
+    for(auto& pending : pendingPresents) {
+        pending.fence->wait();
+    }
+    collectPresentFences();
     vkDestroySwapchainKHR(device->getDevice(), swapchain, nullptr);
     swapChainImages.clear();
     imageViews.clear();
     std::cout << "swapchain destroyed" << std::endl;
 }
 
-void SwapChain::initSwapchain() {
+void SwapChain::initSwapchain(VkSwapchainKHR oldSwapchain) {
     std::cout << "creating new swapchain" << std::endl;
     SwapChainSupportDetails swapChainSupport = device->getSwapChainDetails();
 
     VkSurfaceFormatKHR surfaceFormat = choseSwapSurfaceFormat(swapChainSupport.formats);
-    VkPresentModeKHR presentMode = choseSwapPresentMode(swapChainSupport.presentModes);
+    presentMode = choseSwapPresentMode(swapChainSupport.presentModes, config.presentMode);
     VkExtent2D extent = choseSwapExtent(swapChainSupport.capabilities, window);
     
     swapchainImageFormat = surfaceFormat.format;
     swapchainImageExtent = extent;
 
-    uint32_t imageCount = swapChainSupport.capabilities.minImageCount + 1;
-
-    if(swapChainSupport.capabilities.maxImageCount > 0 && imageCount > swapChainSupport.capabilities.maxImageCount) {
-        imageCount = swapChainSupport.capabilities.maxImageCount;
-    }
+    uint32_t imageCount = choseSwapImageCount(swapChainSupport.capabilities, config.swapchainImageCount);
 
     VkSwapchainCreateInfoKHR createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
@@ -120,13 +160,13 @@ void SwapChain::initSwapchain() {
     createInfo.presentMode = presentMode;
     createInfo.clipped = VK_TRUE;
 
-    createInfo.oldSwapchain = VK_NULL_HANDLE;
+    createInfo.oldSwapchain = oldSwapchain;
 
     if (vkCreateSwapchainKHR(device->getDevice(), &createInfo, nullptr, &swapchain) != VK_SUCCESS) {
         throw std::runtime_error("FAILED TO CREATE SWAPCHAIN!");
     }
 
-    std::cout << "Swapchain created" << std::endl;
+    std::cout << "Swapchain created (" << getPresentModeString(presentMode) << ")" << std::endl;
 
     vkGetSwapchainImagesKHR(device->getDevice(), swapchain, &imageCount, nullptr);
     swapChainImages.resize(imageCount);
@@ -136,7 +176,7 @@ void SwapChain::initSwapchain() {
 
     imageViews.reserve(swapChainImages.size());
     for (size_t i = 0; i < swapChainImages.size(); i++) {
-        imageViews.emplace_back(device, swapChainImages[i], swapchainImageFormat, VK_IMAGE_ASPECT_COLOR_BIT);
+        imageViews.emplace_back(new ImageView(device, swapChainImages[i], swapchainImageFormat, VK_IMAGE_ASPECT_COLOR_BIT));
     }
 
     std::cout << "Created swapchain imageViews" << std::endl;
@@ -168,7 +208,29 @@ bool SwapChain::present(std::vector<Semaphore*> waitSemaphores) {
     presentInfo.pImageIndices = &imageIndex;
     presentInfo.pResults = nullptr;
 
+    //the fence tells the device when this present is done with its semaphore and image
+    uint64_t presentNumber = device->queuePresent();
+    std::unique_ptr<Fence> fence;
+    VkSwapchainPresentFenceInfoEXT fenceInfo{};
+    VkFence fenceHandle = VK_NULL_HANDLE;
+    if(device->hasSwapchainMaintenance1()) {
+        collectPresentFences();
+        if(freeFences.empty()) {
+            fence.reset(new Fence(device));
+        } else {
+            fence = std::move(freeFences.back());
+            freeFences.pop_back();
+        }
+        fenceHandle = fence->getHandle();
+        fenceInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_PRESENT_FENCE_INFO_EXT;
+        fenceInfo.swapchainCount = 1;
+        fenceInfo.pFences = &fenceHandle;
+        presentInfo.pNext = &fenceInfo;
+    }
+
     VkResult result = vkQueuePresentKHR(device->getPresentQueue(), &presentInfo);
+    if(fence)
+        pendingPresents.push_back(PendingPresent{std::move(fence), presentNumber});
     if(result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR) {
         return false;
     } else if(result != VK_SUCCESS) {
@@ -176,4 +238,14 @@ bool SwapChain::present(std::vector<Semaphore*> waitSemaphores) {
     }
 
     return true;
-}
\ No newline at end of file
+}
+
+//presents finish in order, so the first unsignalled fence ends the scan
+void SwapChain::collectPresentFences() {
+    while(!pendingPresents.empty() && pendingPresents.front().fence->isSignaled()) {
+        device->completePresents(pendingPresents.front().presentNumber);
+        pendingPresents.front().fence->reset();
+        freeFences.push_back(std::move(pendingPresents.front().fence));
+        pendingPresents.pop_front();
+    }
+}
@@ -1,6 +1,7 @@
 #include "buffer.h"
 #include "image.h"
 #include "imageview.h"
+#include "upload_batch.h"
 #include <cstddef>
 #include <cstring>
 #include <memory>
@@ -10,7 +11,7 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 
-Texture::Texture(Device* device, const char* file) :
+Texture::Texture(Device* device, const char* file, UploadBatch* batch) :
     device(device) {
     int texWidth, texHeight, texChannels;
     stbi_uc* pixels = stbi_load(file, &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
@@ -22,15 +23,15 @@ Texture::Texture(Device* device, const char* file) :
         throw std::runtime_error("FAILED TO LOAD TEXTURE IMAGE");
     }
 
-    Buffer stagingBuffer(device, imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_SHARING_MODE_EXCLUSIVE, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-    void* data = stagingBuffer.mapBuffer();
-    memcpy(data, pixels, static_cast<size_t>(imageSize));
-    stagingBuffer.unmapBuffer();
+    //without a batch to join the texture is uploaded on its own and waited on
+    if(batch != nullptr) {
+        batch->uploadImage(textureImage.get(), pixels, imageSize, texWidth, texHeight);
+    } else {
+        UploadBatch ownBatch(device);
+        ownBatch.uploadImage(textureImage.get(), pixels, imageSize, texWidth, texHeight);
+        ownBatch.submit().wait();
+    }
     stbi_image_free(pixels);
-    
-    textureImage->transitionImageLayout(VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-    textureImage->bufferToImage(&stagingBuffer, texWidth, texHeight);
-    textureImage->transitionImageLayout(VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 
     textureImageView = std::unique_ptr<ImageView>(new ImageView(device, textureImage->getHandle(), VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_ASPECT_COLOR_BIT));
 
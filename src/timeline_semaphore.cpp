@@ -0,0 +1,84 @@
+#include <cstdint>
+#include <stdexcept>
+#include <timeline_semaphore.h>
+#include <vulkan/vulkan_core.h>
+
+bool TimelinePoint::isReached() {
+    return timeline == nullptr || timeline->isReached(value);
+}
+
+void TimelinePoint::wait() {
+    if(timeline != nullptr)
+        timeline->wait(value);
+}
+
+TimelineSemaphore::TimelineSemaphore(Device* device, uint64_t initialValue) :
+    device(device), lastReserved(initialValue), lastCompleted(initialValue) {
+    VkSemaphoreTypeCreateInfo typeInfo{};
+    typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    typeInfo.initialValue = initialValue;
+
+    VkSemaphoreCreateInfo createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    createInfo.pNext = &typeInfo;
+
+    if(vkCreateSemaphore(device->getDevice(), &createInfo, nullptr, &semaphore) != VK_SUCCESS) {
+        throw std::runtime_error("FAILED TO CREATE TIMELINE SEMAPHORE");
+    }
+}
+
+TimelineSemaphore::~TimelineSemaphore() {
+    vkDestroySemaphore(device->getDevice(), semaphore, nullptr);
+}
+
+TimelinePoint TimelineSemaphore::reserve() {
+    lastReserved++;
+    return TimelinePoint{this, lastReserved};
+}
+
+uint64_t TimelineSemaphore::getCompletedValue() {
+    if(vkGetSemaphoreCounterValue(device->getDevice(), semaphore, &lastCompleted) != VK_SUCCESS) {
+        throw std::runtime_error("FAILED TO QUERY TIMELINE SEMAPHORE");
+    }
+    return lastCompleted;
+}
+
+bool TimelineSemaphore::isReached(uint64_t value) {
+    if(value <= lastCompleted)
+        return true;
+    return getCompletedValue() >= value;
+}
+
+bool TimelineSemaphore::wait(uint64_t value, uint64_t timeout) {
+    if(value <= lastCompleted)
+        return true;
+
+    VkSemaphoreWaitInfo waitInfo{};
+    waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+    waitInfo.semaphoreCount = 1;
+    waitInfo.pSemaphores = &semaphore;
+    waitInfo.pValues = &value;
+
+    VkResult result = vkWaitSemaphores(device->getDevice(), &waitInfo, timeout);
+    if(result == VK_TIMEOUT)
+        return false;
+    if(result != VK_SUCCESS) {
+        throw std::runtime_error("FAILED TO WAIT ON TIMELINE SEMAPHORE");
+    }
+    lastCompleted = value > lastCompleted ? value : lastCompleted;
+    return true;
+}
+
+//lets the cpu stand in for a queue, mostly useful to unblock work waiting on a value that will never be submitted
+void TimelineSemaphore::signal(uint64_t value) {
+    VkSemaphoreSignalInfo signalInfo{};
+    signalInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SIGNAL_INFO;
+    signalInfo.semaphore = semaphore;
+    signalInfo.value = value;
+
+    if(vkSignalSemaphore(device->getDevice(), &signalInfo) != VK_SUCCESS) {
+        throw std::runtime_error("FAILED TO SIGNAL TIMELINE SEMAPHORE");
+    }
+    lastReserved = value > lastReserved ? value : lastReserved;
+}
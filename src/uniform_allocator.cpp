@@ -0,0 +1,43 @@
+#include "buffer.h"
+#include "memory_allocator.h"
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <stdexcept>
+#include <uniform_allocator.h>
+#include <vulkan/vulkan_core.h>
+
+UniformAllocator::UniformAllocator(Device* device, uint32_t framesInFlight, VkDeviceSize capacity) :
+    device(device), capacity(capacity) {
+    alignment = std::max<VkDeviceSize>(device->getProperties().limits.minUniformBufferOffsetAlignment, 1);
+    buffers.reserve(framesInFlight);
+    for(uint32_t i = 0; i < framesInFlight; i++) {
+        buffers.emplace_back(device, capacity, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_SHARING_MODE_EXCLUSIVE, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, MEMORY_USAGE_DYNAMIC);
+        mapped.push_back(static_cast<char*>(buffers[i].mapBuffer()));
+    }
+}
+
+UniformAllocator::~UniformAllocator() {
+    printStats();
+}
+
+void UniformAllocator::beginFrame(uint32_t frame) {
+    this->frame = frame;
+    head = 0;
+}
+
+UniformSlice UniformAllocator::allocate(VkDeviceSize size) {
+    VkDeviceSize offset = (head + alignment - 1) / alignment * alignment;
+    if(offset + size > capacity) {
+        throw std::runtime_error("UNIFORM ALLOCATOR OUT OF SPACE FOR THIS FRAME");
+    }
+    head = offset + size;
+    peakBytes = std::max(peakBytes, head);
+    allocationCount++;
+    return UniformSlice{static_cast<uint32_t>(offset), mapped[frame] + offset};
+}
+
+void UniformAllocator::printStats() {
+    std::cout << "Uniform allocator: " << allocationCount << " blocks, peak " << peakBytes << " of " << capacity << " bytes in a frame, "
+        << alignment << " byte alignment" << std::endl;
+}
@@ -0,0 +1,161 @@
+#include "buffer.h"
+#include "image.h"
+#include "staging_ring.h"
+#include <iostream>
+#include <memory>
+#include <upload_batch.h>
+#include <vulkan/vulkan_core.h>
+
+UploadBatch::UploadBatch(Device* device) :
+    device(device), dedicatedTransfer(device->hasDedicatedTransferQueue()),
+    transferPool(device, device->getTransferFamily()), transferCmd(device, &transferPool) {
+    //the acquire half of the ownership transfer has to be recorded on a graphics family command buffer
+    if(dedicatedTransfer) {
+        graphicsPool = std::unique_ptr<CommandPool>(new CommandPool(device, device->getQueueFamilies().graphicsFamily.value()));
+        graphicsCmd = std::unique_ptr<CommandBuffer>(new CommandBuffer(device, graphicsPool.get()));
+    }
+}
+
+UploadBatch::~UploadBatch() {
+    //the command buffer can't be freed while the gpu is still executing it
+    token.wait();
+}
+
+void UploadBatch::begin() {
+    if(recording)
+        return;
+
+    //reusing the batch, the previous submission has to be done with the command buffer first
+    token.wait();
+    transferCmd.reset();
+    transferCmd.startRecording();
+    pendingBuffers.clear();
+    pendingImages.clear();
+    recording = true;
+    bufferCopies = 0;
+    imageCopies = 0;
+    transitions = 0;
+}
+
+void UploadBatch::copyBuffer(Buffer* src, Buffer* dst, VkDeviceSize size, VkDeviceSize srcOffset, VkDeviceSize dstOffset) {
+    begin();
+    VkBufferCopy copyRegion{};
+    copyRegion.srcOffset = srcOffset;
+    copyRegion.dstOffset = dstOffset;
+    copyRegion.size = size;
+    vkCmdCopyBuffer(transferCmd.getHandle(), src->getHandle(), dst->getHandle(), 1, &copyRegion);
+    bufferCopies++;
+
+    if(dedicatedTransfer) {
+        VkBufferMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        barrier.srcQueueFamilyIndex = device->getTransferFamily();
+        barrier.dstQueueFamilyIndex = device->getQueueFamilies().graphicsFamily.value();
+        barrier.buffer = dst->getHandle();
+        barrier.offset = dstOffset;
+        barrier.size = size;
+        pendingBuffers.push_back(barrier);
+    }
+}
+
+void UploadBatch::uploadBuffer(Buffer* dst, const void* data, VkDeviceSize size, VkDeviceSize dstOffset) {
+    StagingSlice slice = device->getStagingRing()->stage(data, size);
+    copyBuffer(slice.buffer, dst, size, slice.offset, dstOffset);
+}
+
+void UploadBatch::copyBufferToImage(Buffer* src, Image* dst, uint32_t width, uint32_t height, VkDeviceSize srcOffset) {
+    begin();
+    dst->bufferToImage(&transferCmd, src, width, height, srcOffset);
+    imageCopies++;
+}
+
+void UploadBatch::uploadImage(Image* dst, const void* data, VkDeviceSize size, uint32_t width, uint32_t height) {
+    StagingSlice slice = device->getStagingRing()->stage(data, size);
+    transitionImageLayout(dst, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+    copyBufferToImage(slice.buffer, dst, width, height, slice.offset);
+    //a transfer queue can't transition into a shader stage layout, that happens as part of the ownership transfer
+    if(dedicatedTransfer) {
+        pendingImages.push_back({dst, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL});
+        transitions++;
+    } else {
+        transitionImageLayout(dst, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    }
+}
+
+void UploadBatch::transitionImageLayout(Image* image, VkImageLayout newLayout) {
+    begin();
+    image->transitionImageLayout(&transferCmd, newLayout);
+    transitions++;
+}
+
+UploadToken UploadBatch::submit() {
+    if(!recording)
+        return token;
+
+    //the staged slices are free again once the last submission of the batch is done
+    TimelinePoint point = dedicatedTransfer ? submitWithOwnershipTransfer() : submitSingleQueue();
+    device->getStagingRing()->endBatch(point);
+    recording = false;
+    token = UploadToken(point);
+
+    std::cout << "Upload batch submitted" << (dedicatedTransfer ? " on transfer queue: " : ": ") << bufferCopies << " buffer copies, "
+        << imageCopies << " image copies, " << transitions << " layout transitions" << std::endl;
+    return token;
+}
+
+TimelinePoint UploadBatch::submitSingleQueue() {
+    //make the copied buffers visible to anything submitted after this batch, images are covered by their layout transitions
+    if(bufferCopies > 0) {
+        VkMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+        vkCmdPipelineBarrier(transferCmd.getHandle(), VK_PIPELINE_STAGE_TRANSFER_BIT,
+            VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+    }
+
+    transferCmd.stopRecording();
+    TimelinePoint point = device->getGraphicsTimeline()->reserve();
+    transferCmd.submit(device->getGraphicsQueue(), point);
+    return point;
+}
+
+TimelinePoint UploadBatch::submitWithOwnershipTransfer() {
+    uint32_t transferFamily = device->getTransferFamily();
+    uint32_t graphicsFamily = device->getQueueFamilies().graphicsFamily.value();
+
+    //release everything written on the transfer queue, the graphics queue acquires the same ranges below
+    for(auto& barrier : pendingBuffers) {
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = 0;
+    }
+    if(!pendingBuffers.empty()) {
+        vkCmdPipelineBarrier(transferCmd.getHandle(), VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+            0, nullptr, static_cast<uint32_t>(pendingBuffers.size()), pendingBuffers.data(), 0, nullptr);
+    }
+    for(auto& pending : pendingImages) {
+        pending.image->releaseOwnership(&transferCmd, pending.finalLayout, transferFamily, graphicsFamily);
+    }
+    transferCmd.stopRecording();
+    TimelinePoint released = device->getTransferTimeline()->reserve();
+    transferCmd.submit(device->getTransferQueue(), released);
+
+    graphicsCmd->reset();
+    graphicsCmd->startRecording();
+    for(auto& barrier : pendingBuffers) {
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+    }
+    if(!pendingBuffers.empty()) {
+        vkCmdPipelineBarrier(graphicsCmd->getHandle(), VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+            VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+            0, nullptr, static_cast<uint32_t>(pendingBuffers.size()), pendingBuffers.data(), 0, nullptr);
+    }
+    for(auto& pending : pendingImages) {
+        pending.image->acquireOwnership(graphicsCmd.get(), pending.finalLayout, transferFamily, graphicsFamily);
+    }
+    graphicsCmd->stopRecording();
+    TimelinePoint acquired = device->getGraphicsTimeline()->reserve();
+    graphicsCmd->submit(device->getGraphicsQueue(), acquired, {released}, {VK_PIPELINE_STAGE_ALL_COMMANDS_BIT});
+    return acquired;
+}